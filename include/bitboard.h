@@ -5,6 +5,7 @@
 #define __BITBOARD_H__
 
 #include <stdint.h>
+#include <assert.h>
 
 /// bitboard typedef(also called bitsets or bitmaps)
 /// used to represent the board inside a chess program in
@@ -57,9 +58,27 @@ extern const U64 DARK_SQUARES;
 /// \see https://www.chessprogramming.org/BitScan
 #define remove_lsb(bitboard) ((bitboard) &= (bitboard - 1))
 
+/// Bit scans and population count are implemented with compiler builtins
+/// (which become tzcnt/lzcnt/popcnt when the target supports them), unless
+/// the compiler doesn't provide them or BB_PORTABLE_BITSCAN is defined.
+#if !defined(BB_PORTABLE_BITSCAN) && (defined(__GNUC__) || defined(__clang__))
+	#define BB_BUILTIN_BITSCAN
+#endif
+
+#ifndef BB_BUILTIN_BITSCAN
 /// A set of indexes used in the implementation of the bit_scan functions
 /// \see https://www.chessprogramming.org/BitScan#With_separated_LS1B
-static const uint32_t bit_scan_indexes[64];
+static const uint32_t bit_scan_indexes[64] = {
+	0,  47, 1,  56, 48, 27, 2,  60,
+	57, 49, 41, 37, 28, 16, 3,  61,
+	54, 58, 35, 52, 50, 42, 21, 44,
+	38, 32, 29, 23, 17, 11, 4,  62,
+	46, 55, 26, 59, 40, 36, 15, 53,
+	34, 51, 20, 43, 31, 22, 10, 45,
+	25, 39, 14, 33, 19, 30, 9,  24,
+	13, 18, 8,  12, 7,  6,  5,  63
+};
+#endif
 
 /**
  * \brief a function that determines the bit-index of the least significant 1
@@ -71,7 +90,18 @@ static const uint32_t bit_scan_indexes[64];
  *
  * \see https://www.chessprogramming.org/BitScan
  */
-uint32_t bit_scan_forward(U64 bitboard);
+static inline uint32_t bit_scan_forward(U64 bitboard)
+{
+	assert(bitboard != 0);
+
+#ifdef BB_BUILTIN_BITSCAN
+	return __builtin_ctzll(bitboard);
+#else
+	return bit_scan_indexes[
+		((bitboard ^ (bitboard - 1ULL)) * 0x03f79d71b4cb0a89ULL) >> 58
+	];
+#endif
+}
 
 /**
  * \brief a function that determines the bit-index of the most significant 1
@@ -83,7 +113,22 @@ uint32_t bit_scan_forward(U64 bitboard);
  *
  * \see https://www.chessprogramming.org/BitScan
  */
-uint32_t bit_scan_reverse(U64 bitboard);
+static inline uint32_t bit_scan_reverse(U64 bitboard)
+{
+	assert(bitboard != 0);
+
+#ifdef BB_BUILTIN_BITSCAN
+	return 63 ^ __builtin_clzll(bitboard);
+#else
+	bitboard |= bitboard >> 1ULL;
+	bitboard |= bitboard >> 2ULL;
+	bitboard |= bitboard >> 4ULL;
+	bitboard |= bitboard >> 8ULL;
+	bitboard |= bitboard >> 16ULL;
+	bitboard |= bitboard >> 32ULL;
+	return bit_scan_indexes[(bitboard * 0x03f79d71b4cb0a89ULL) >> 58ULL];
+#endif
+}
 
 /**
  * \brief An operation to determine the cardinality of a bitboard, also called
@@ -97,6 +142,21 @@ uint32_t bit_scan_reverse(U64 bitboard);
  * \see https://en.wikipedia.org/wiki/Cardinality
  * \see https://en.wikipedia.org/wiki/Hamming_weight
  */
-uint32_t population_count(U64 bitboard);
+static inline uint32_t population_count(U64 bitboard)
+{
+#ifdef BB_BUILTIN_BITSCAN
+	return __builtin_popcountll(bitboard);
+#else
+	// \see https://www.chessprogramming.org/Population_Count#SWAR-Popcount
+	bitboard = bitboard - ((bitboard >> 1) & 0x5555555555555555ULL);
+	bitboard = (
+		(bitboard & 0x3333333333333333ULL)
+		+ ((bitboard >> 2) & 0x3333333333333333ULL)
+	);
+	bitboard = (bitboard + (bitboard >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+	return (bitboard * 0x0101010101010101ULL) >> 56;
+#endif
+}
 
 #endif
@@ -0,0 +1,27 @@
+/**
+ * \file
+ */
+#ifndef __BYTEBOARD_H__
+#define __BYTEBOARD_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * \brief Initializes the engine: the hash keys, the attack tables, the table
+ * of late move reductions and the transposition table. Must be called once,
+ * before anything else of the engine is used.
+ *
+ * \param hash_megabytes size of the transposition table
+ *
+ * \return false if memory allocation of the transposition table failed, the
+ * engine works without it then
+ */
+bool byteboard_init(size_t hash_megabytes);
+
+/**
+ * \brief Frees the transposition table and the perft hash table
+ */
+void byteboard_free(void);
+
+#endif
@@ -72,6 +72,22 @@ Evaluation evaluate_midgame(const Position *pos);
  */
 Evaluation evaluate_endgame(const Position *pos);
 
+/**
+ * \brief Static exchange evaluation. Plays out all the captures on the
+ * destination square of the move, least valuable attackers first, and
+ * returns the material balance for the side to move. Either side may stop
+ * capturing when continuing would lose material.
+ *
+ * \param position position
+ *
+ * \param move #COMMON move, usually a capture
+ *
+ * \return material won (positive) or lost (negative) by the move
+ *
+ * \see https://www.chessprogramming.org/Static_Exchange_Evaluation
+ */
+Evaluation static_exchange(const Position *position, Move move);
+
 /**
  * \brief Evaluates the position on the material on both sides
  *
@@ -10,39 +10,59 @@
 /// Random side key
 extern U64 side_key;
 
-/// Unique position hash key
-extern U64 hash_key;
-
 /// Random piece keys
 extern U64 piece_keys[12][64];
 
-/// Random en passant keys
-extern U64 en_passant_keys[64];
+/// Random en passant keys, indexed by the file of the en passant square
+extern U64 en_passant_keys[8];
 
-/// Random castling keys
+/// Random castling keys, one for every combination of #Castling flags
 extern U64 castling_keys[16];
 
 /**
- * \brief Generates random u32 number
+ * \brief Returns the random key of the piece on the square
+ *
+ * \param piece piece
  *
- * \return random u32 number
+ * \param sq square
  */
-uint32_t get_random_U32_number(void);
+static inline U64 piece_key(Piece piece, Square sq)
+{
+	return piece_keys[
+		color_of_piece(piece) * 6 + type_of_piece(piece) - 1
+	][sq];
+}
 
 /**
- * \brief Generates random u64 number
+ * \brief Returns the en passant key of the square, or 0 if there is no en
+ * passant square
+ *
+ * \param en_passant en passant square or #SQ_NONE
+ */
+static inline U64 en_passant_key(Square en_passant)
+{
+	return en_passant == SQ_NONE ? 0 : en_passant_keys[file_of(en_passant)];
+}
+
+/**
+ * \brief Generates random u64 number with splitmix64
  *
  * \return random u64 number
+ *
+ * \see https://prng.di.unimi.it/splitmix64.c
  */
 U64 get_random_U64_number(void);
 
 /**
- * \brief Initializes all hash keys with random numbers
+ * \brief Initializes all hash keys with random numbers. The generator is
+ * reseeded, so the keys are the same after every call.
  */
 void init_hash_keys(void);
 
 /**
- * \brief Generates unique hash key for the position
+ * \brief Generates unique hash key for the position from scratch. The key is
+ * maintained incrementally in PositionState::key, this function is meant for
+ * initialization and debug checks.
  *
  * \param pos current position
  *
@@ -9,6 +9,32 @@
 #include "piece.h"
 #include "rays.h"
 
+/// Fancy magic bitboard entry of one square. Stores everything needed to
+/// turn an occupancy into an index of the precomputed attack table.
+/// \see https://www.chessprogramming.org/Magic_Bitboards
+typedef struct Magic {
+	U64 mask;	///< Relevant occupancy (board edges are excluded)
+	U64 magic;	///< Magic factor
+	U64 *attacks;	///< Attacks of the square inside the shared table
+	uint32_t shift;	///< 64 minus number of bits in #mask
+} Magic;
+
+/// Magic entries for the rook attacks
+extern Magic rook_magics[SQ_NB];
+/// Magic entries for the bishop attacks
+extern Magic bishop_magics[SQ_NB];
+
+/**
+ * \brief Fills #rook_magics, #bishop_magics and the attack tables they point
+ * to. Must be called after init_rays(), before any slider attack is used.
+ *
+ * When compiled with USE_PEXT on a BMI2 target, the tables are indexed by the
+ * pext instruction instead of the magic multiplication.
+ *
+ * \see https://www.chessprogramming.org/BMI2#PEXTBitboards
+ */
+void init_slider_attacks(void);
+
 /**
  * \brief Returns the bit of the board, where bits equal to one indicate the
  * squares to which the pawn can move, not ignoring enemy pieces.
@@ -51,6 +77,32 @@ U64 pawn_attack_mask(Square target, U64 occupied, Color color);
  */
 U64 pawn_mask(Square target, U64 occupied, Color color);
 
+/**
+ * \brief Calculates rook attacks by scanning the four rays from the target
+ * square. This is slow, it is used to fill the attack tables and to check
+ * them.
+ *
+ * \param target square with rook
+ *
+ * \param occupied bitboard with chess pieces
+ *
+ * \return bitboard with rook move mask
+ */
+U64 rook_ray_attacks_mask(Square target, U64 occupied);
+
+/**
+ * \brief Calculates bishop attacks by scanning the four rays from the target
+ * square. This is slow, it is used to fill the attack tables and to check
+ * them.
+ *
+ * \param target square with bishop
+ *
+ * \param occupied bitboard with chess pieces
+ *
+ * \return bitboard with bishop move mask
+ */
+U64 bishop_ray_attacks_mask(Square target, U64 occupied);
+
 /**
  * \brief Returns the bit of the board, where bits equal to one indicate the
  * squares to which the rook can move, not ignoring enemy pieces.
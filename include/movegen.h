@@ -10,16 +10,19 @@
 #include "masks.h"
 
 /// Macro to add a move to move_list.
-#define ml_add(move_list, move) (*(move_list)->last++ = (move))
+#define ml_add(ml, move) (*(ml)->last++ = (move))
 
 /// Macro to get move_list len
-#define ml_len(move_list) ((move_list)->last - (move_list)->move_list)
+#define ml_len(ml) ((ml)->last - (ml)->move_list)
 
 /// Macro to remove a last move in move_list.
-#define ml_remove_last(move_list) (--(move_list)->last)
+#define ml_remove_last(ml) (--(ml)->last)
 
 /// Macro to remove a last move in move_list and return this move.
-#define ml_pop(move_list) (*--(move_list)->last)
+#define ml_pop(ml) (*--(ml)->last)
+
+/// Macro to remove all moves from move_list.
+#define ml_clear(ml) ((ml)->last = (ml)->move_list)
 
 
 /// Approximate number of available half moves for one position.
@@ -31,6 +34,69 @@ typedef struct MoveList {
 	ExtMove *last;			///< Pointer to the last element in array.
 } MoveList;
 
+/// Check and pin information of the side to move. Computed once per node by
+/// init_check_info() and shared by all the move generators.
+typedef struct CheckInfo {
+	Square king_square;	///< Square of the king of the side to move
+	U64 checkers;		///< Enemy pieces giving check to the king
+
+	/// Squares where a move of a piece other than the king resolves the
+	/// check: the checker and the squares between it and the king.
+	/// #UNIVERSE without check and #EMPTY in double check.
+	U64 check_ray;
+
+	U64 pinned;		///< Ally pieces pinned to the king
+
+	/// Squares a pinned piece may move to: the squares between the king
+	/// and the pinner and the pinner itself. Valid only for the squares of
+	/// #pinned pieces, use pin_ray() to read it.
+	U64 pin_rays[SQ_NB];
+
+	/// Squares from which a piece of the side to move would give check to
+	/// the enemy king, indexed by #PieceType
+	U64 check_squares[PIECE_TYPE_NB + 1];
+} CheckInfo;
+
+/// Selects the moves produced by the generators. #GEN_PSEUDO_LEGAL may be
+/// combined with any of the other values.
+typedef enum GenType {
+	GEN_CAPTURES = 1,	///< Captures, en passant and promotions to a queen
+	GEN_QUIETS = 2,		/*!< Moves to empty squares, castlings and
+				under-promotions, all the moves #GEN_CAPTURES
+				skips */
+	GEN_ALL = GEN_CAPTURES | GEN_QUIETS,	///< All legal moves
+
+	/// Skips the checks of pins and king moves, such moves must pass
+	/// is_legal() before they are made. Check evasions of the other
+	/// pieces, castlings and en passant are still generated legal.
+	GEN_PSEUDO_LEGAL = 4,
+} GenType;
+
+/**
+ * \brief Fills the check info of the side to move
+ *
+ * \param pos current position
+ *
+ * \param check_info check info to fill
+ */
+void init_check_info(const Position *pos, CheckInfo *check_info);
+
+/**
+ * \brief Returns the squares the piece on the source square may move to
+ * without exposing the king, #UNIVERSE for pieces that aren't pinned
+ *
+ * \param check_info check info of the current position
+ *
+ * \param source source square
+ */
+static inline U64 pin_ray(const CheckInfo *check_info, Square source)
+{
+	return (
+		check_info->pinned & square_to_bitboard(source)
+		? check_info->pin_rays[source] : UNIVERSE
+	);
+}
+
 /**
  * \brief Initialize #MoveList.
  *
@@ -38,9 +104,40 @@ typedef struct MoveList {
  */
 MoveList *init_move_list(void);
 
+/**
+ * \brief Fills the given move list with all legal moves available at the
+ * given position. The list is cleared first, so the same preallocated
+ * #MoveList can be reused for every node at a given ply.
+ *
+ * \param pos current position
+ *
+ * \param move_list caller-owned move list
+ *
+ * \return move_list or NULL in case generation failed.
+ *
+ * \see https://www.chessprogramming.org/Move_Generation
+ */
+MoveList *generate_moves(Position *pos, MoveList *move_list);
+
+/**
+ * \brief Counts the legal moves of the position without building a
+ * #MoveList: the destination sets of the pieces are only popcounted. Used by
+ * perft at the last ply.
+ *
+ * \param pos current position
+ *
+ * \return number of the legal moves, the same as the length of the list
+ * #generate_moves fills
+ *
+ * \see https://www.chessprogramming.org/Perft#Bulk-counting
+ */
+uint32_t count_legal_moves(Position *pos);
+
 /**
  * \brief Returns a special structure with an array of all
- * legal moves available at the given position.
+ * legal moves available at the given position. The list is allocated with
+ * #init_move_list and must be freed by the caller, prefer #generate_moves in
+ * hot paths.
  *
  * \param pos current position
  *
@@ -51,14 +148,101 @@ MoveList *init_move_list(void);
  */
 MoveList *generate_all_moves(Position *pos);
 
+/**
+ * \brief Adds legal captures, en passant and promotions to a queen to the
+ * move list. Unlike #generate_moves, the list isn't cleared, so the stages of
+ * the move picker can share one list.
+ *
+ * \param pos current position
+ *
+ * \param check_info check info of the current position
+ *
+ * \param move_list caller-owned move list
+ *
+ * \return move_list
+ */
+MoveList *generate_captures(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list
+);
+
+/**
+ * \brief Adds the legal moves #generate_captures skips to the move list. The
+ * list isn't cleared.
+ *
+ * \param pos current position
+ *
+ * \param check_info check info of the current position
+ *
+ * \param move_list caller-owned move list
+ *
+ * \return move_list
+ */
+MoveList *generate_quiets(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list
+);
+
+/**
+ * \brief Adds the moves of the #GenType to the move list without checking
+ * pins and king moves. The list isn't cleared. Legality is
+ * checked by is_legal() only for the moves actually searched.
+ *
+ * \param pos current position
+ *
+ * \param check_info check info of the current position
+ *
+ * \param move_list caller-owned move list
+ *
+ * \param type #GEN_CAPTURES, #GEN_QUIETS or #GEN_ALL
+ *
+ * \return move_list
+ */
+MoveList *generate_pseudo_legal(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list,
+	GenType type
+);
+
+/**
+ * \brief Checks whether the move is one of the legal moves of the position.
+ * Only the moves of the moving piece are generated, so it is cheap enough to
+ * verify the hash move and killers before searching them.
+ *
+ * \param pos current position
+ *
+ * \param check_info check info of the current position
+ *
+ * \param move any move, #MOVE_NONE and #MOVE_NULL are never legal
+ *
+ * \return true if the move is legal
+ */
+bool is_valid_move(Position *pos, const CheckInfo *check_info, Move move);
+
+/**
+ * \brief Checks whether a move produced by generate_pseudo_legal() leaves the
+ * king safe: a pinned piece stays on its pin ray and the king doesn't step
+ * onto an attacked square.
+ *
+ * \param pos current position
+ *
+ * \param check_info check info of the current position
+ *
+ * \param move pseudo-legal move
+ *
+ * \return true if the move is legal
+ */
+bool is_legal(const Position *pos, const CheckInfo *check_info, Move move);
+
 /**
  * \brief Adds to the move_list all moves from the Square source
  * for each destination from the destinations bitboard.
  *
  * \param move_list the list of all moves
  *
- * \param piece given piece
- *
  * \param source source square
  *
  * \param destinations bitboard with all destinations
@@ -67,7 +251,6 @@ MoveList *generate_all_moves(Position *pos);
  */
 void add_common_moves(
 	MoveList *move_list,
-	const Piece piece,
 	const Square source,
 	U64 destinations
 );
@@ -96,8 +279,6 @@ void add_castlings(
  *
  * \param move_list the list of all moves
  *
- * \param color pawn color
- *
  * \param source source square
  *
  * \param destinations bitboard with all destinations
@@ -106,7 +287,6 @@ void add_castlings(
  */
 void add_promotions(
 	MoveList *move_list,
-	Color color,
 	Square source,
 	U64 destinations
 );
@@ -117,8 +297,6 @@ void add_promotions(
  *
  * \param move_list the list of all moves
  *
- * \param color pawn color
- *
  * \param sources bitboard with all source squares
  *
  * \param destination destination square
@@ -127,7 +305,6 @@ void add_promotions(
  */
 void add_en_passant(
 	MoveList *move_list,
-	Color color,
 	U64 sources,
 	Square destination
 );
@@ -185,19 +362,19 @@ U64 king_safe_moves_mask(
  *
  * \param pos current position
  *
+ * \param check_info check info of the current position
+ *
  * \param source source square
  *
  * \param destinations bitboard with all destinations
  *
- * \param check_ray check ray
- *
  * \return bitboard with legal moves
  */
 U64 filter_legal_moves(
-	Position *pos,
+	const Position *pos,
+	const CheckInfo *check_info,
 	Square source,
-	U64 destinations,
-	U64 check_ray
+	U64 destinations
 );
 
 /**
@@ -208,10 +385,15 @@ U64 filter_legal_moves(
  *
  * \param pos current position
  *
- * \param check_ray check ray
+ * \param check_info check info of the current position
+ *
+ * \param type #GenType of the generated moves
  */
 void generate_knight_moves(
-	MoveList *move_list, Position *pos, U64 check_ray
+	MoveList *move_list,
+	Position *pos,
+	const CheckInfo *check_info,
+	GenType type
 );
 
 /**
@@ -222,10 +404,15 @@ void generate_knight_moves(
  *
  * \param pos current position
  *
- * \param check_ray check ray
+ * \param check_info check info of the current position
+ *
+ * \param type #GenType of the generated moves
  */
 void generate_pawn_moves(
-	MoveList *move_list, Position *pos, U64 check_ray
+	MoveList *move_list,
+	Position *pos,
+	const CheckInfo *check_info,
+	GenType type
 );
 
 /**
@@ -235,7 +422,9 @@ void generate_pawn_moves(
  *
  * \param position current position
  *
- * \param check_ray check ray
+ * \param check_info check info of the current position
+ *
+ * \param type #GenType of the generated moves
  *
  * \param pawns_on_last_rank pawns on the #RANK_2 (for #BLACK) or #RANK_7 (for
  * #WHITE)
@@ -243,7 +432,8 @@ void generate_pawn_moves(
 void generate_pawn_promotions(
 	MoveList *move_list,
 	Position *position,
-	U64 check_ray,
+	const CheckInfo *check_info,
+	GenType type,
 	U64 pawns_on_last_rank
 );
 
@@ -254,7 +444,9 @@ void generate_pawn_promotions(
  *
  * \param position current position
  *
- * \param check_ray check ray
+ * \param check_info check info of the current position
+ *
+ * \param type #GenType of the generated moves
  *
  * \param pawns pawns without pawns on the #RANK_2 (for #BLACK) or #RANK_7 (
  * for #WHITE)
@@ -262,7 +454,8 @@ void generate_pawn_promotions(
 void generate_pawn_common(
 	MoveList *move_list,
 	Position *position,
-	U64 check_ray,
+	const CheckInfo *check_info,
+	GenType type,
 	U64 pawns
 );
 
@@ -273,12 +466,12 @@ void generate_pawn_common(
  *
  * \param position current position
  *
- * \param check_ray check ray
+ * \param check_info check info of the current position
  */
 void generate_pawn_en_passant(
 	MoveList *move_list,
 	Position *pos,
-	U64 check_ray
+	const CheckInfo *check_info
 );
 
 /**
@@ -291,7 +484,9 @@ void generate_pawn_en_passant(
  *
  * \param pt piece type
  *
- * \param check_ray check ray
+ * \param check_info check info of the current position
+ *
+ * \param type #GenType of the generated moves
  *
  * \param get_attacks pointer to the mask function
  *
@@ -301,7 +496,8 @@ void generate_sliding_pieces(
 	MoveList *move_list,
 	Position *pos,
 	PieceType pt,
-	U64 check_ray,
+	const CheckInfo *check_info,
+	GenType type,
 	U64 (*get_attacks)(Square target, U64 occupied)
 );
 
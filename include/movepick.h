@@ -0,0 +1,90 @@
+/**
+ * \file
+ */
+#ifndef __MOVEPICK_H__
+#define __MOVEPICK_H__
+
+#include "bitboard.h"
+#include "position.h"
+#include "evaluate.h"
+#include "movegen.h"
+
+/// Stages of the move picker in the order the moves are returned. A stage
+/// generates its moves only when it is reached, so a cutoff on the hash move
+/// or a good capture skips the generation of the quiet moves.
+typedef enum PickStage {
+	STAGE_HASH_MOVE,		///< The hash move
+	STAGE_GENERATE_CAPTURES,	///< Generating and scoring captures
+	STAGE_GOOD_CAPTURES,		///< Captures by #mvv_lva
+	STAGE_KILLERS,			///< Killer moves
+	STAGE_GENERATE_QUIETS,		///< Generating and scoring quiet moves
+	STAGE_QUIETS,			///< Quiet moves by history
+	STAGE_BAD_CAPTURES,		/*!< Captures of defended pieces by more
+					valuable ones */
+	STAGE_DONE,			///< No moves left
+} PickStage;
+
+/// Move picker state. The moves of all the stages share one #MoveList:
+/// bad captures are moved to its beginning and the quiet moves are generated
+/// right after them.
+typedef struct MovePicker {
+	Position *pos;			///< Current position
+	MoveList *move_list;		///< Caller-owned storage for the moves
+	CheckInfo check_info;		///< Shared by all the stages
+
+	ExtMove *current;		///< Next move of the current stage
+	ExtMove *bad_captures_end;	///< End of the bad captures
+
+	Move hash_move;			///< Legal hash move or #MOVE_NONE
+	Move killers[2];		/*!< Killer moves, #MOVE_NONE once they
+					turn out illegal or captures */
+	uint32_t killer_index;		///< Next killer move to return
+
+	Evaluation (*history)[64];	///< History scores of the quiet moves
+
+	PickStage stage;		///< Current #PickStage
+} MovePicker;
+
+/**
+ * \brief Initializes the move picker. Nothing is generated yet.
+ *
+ * \param picker move picker
+ *
+ * \param pos current position, must not change until the picker is done
+ *
+ * \param move_list caller-owned move list, it is cleared by the picker
+ *
+ * \param hash_move move from the transposition table or #MOVE_NONE, it is
+ * checked for legality
+ *
+ * \param killer_1 first killer move or #MOVE_NONE
+ *
+ * \param killer_2 second killer move or #MOVE_NONE
+ *
+ * \param history history heuristic scores of the searching thread, used to
+ * order quiet moves
+ */
+void init_move_picker(
+	MovePicker *picker,
+	Position *pos,
+	MoveList *move_list,
+	Move hash_move,
+	Move killer_1,
+	Move killer_2,
+	Evaluation history[12][64]
+);
+
+/**
+ * \brief Returns the next move: the hash move, good captures, killers,
+ * quiet moves and bad captures. Every legal move is returned exactly once.
+ * The moves are pseudo-legal, only the hash move and killers are known to be
+ * legal, so each move must pass is_legal() with MovePicker::check_info before
+ * it is made.
+ *
+ * \param picker move picker
+ *
+ * \return next move or #MOVE_NONE if there are no moves left
+ */
+Move next_move(MovePicker *picker);
+
+#endif
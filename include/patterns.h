@@ -25,6 +25,22 @@ extern U64 (*pawn_move_pattern[COLOR_NB]) (Square);
  */
 extern U64 (*pawn_attack_pattern[COLOR_NB]) (Square);
 
+/// Precalculated knight_move_pattern() for each square
+extern U64 knight_attacks[SQ_NB];
+/// Precalculated king_move_pattern() for each square
+extern U64 king_attacks[SQ_NB];
+/// Precalculated pawn_attack_pattern() for each color and square.
+/// Example:
+/// \code{.c}
+/// pawn_attacks[WHITE][SQ_C3];
+/// \endcode
+extern U64 pawn_attacks[COLOR_NB][SQ_NB];
+
+/**
+ * \brief Calculates values for #knight_attacks #king_attacks #pawn_attacks
+ */
+void init_patterns(void);
+
 /**
  * \brief Returns the bit of the board, where bits equal to one indicate the
  * squares to which the white pawn can move
@@ -7,6 +7,31 @@
 #include "bitboard.h"
 #include "position.h"
 
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * \brief Allocates the perft hash table, which stores the node counts of the
+ * subtrees by the zobrist key and the depth. The table is shared by all the
+ * perft threads. The old table is freed and all the entries are lost.
+ *
+ * \param megabytes size of the table, the real size is rounded down to a
+ * power of two entries, 0 disables the table
+ *
+ * \return false if memory allocation failed, the table is disabled then
+ */
+bool perft_table_resize(size_t megabytes);
+
+/**
+ * \brief Frees the perft hash table, perft counts every node again
+ */
+void perft_table_free(void);
+
+/**
+ * \brief Removes all entries from the perft hash table
+ */
+void perft_table_clear(void);
+
 /**
  * \brief Debugging function to walk the move generation tree of strictly legal
  * moves to count all the leaf nodes of a certain depth
@@ -31,4 +56,20 @@ U64 perft(Position *pos, int depth);
  */
 U64 perft_test(Position *pos, int depth);
 
+/**
+ * \brief Multithreaded #perft_test. The subtrees two plies deep are put in a
+ * work queue shared by the threads, every thread walks them on its own copy
+ * of the position. Prints the nodes under every root move in the same format
+ * as #perft_test.
+ *
+ * \param pos current position, left unchanged
+ *
+ * \param depth given depth
+ *
+ * \param threads_nb number of threads, 1 is the same as #perft_test
+ *
+ * \return number of generated nodes
+ */
+U64 perft_parallel(Position *pos, int depth, uint32_t threads_nb);
+
 #endif
@@ -21,17 +21,73 @@ typedef enum MoveType {
 /// Represents one move. To be more precise, a half-move. A move in chess is
 /// two half-moves by both sides. In code, we call a half move a "move" and a
 /// full move a "full move".
-typedef struct Move {
-	MoveType move_type;		///< #MoveType
-	PieceType moved_piece_type;	///< Moved piece type
-	PieceType promotion_piece_type;	/*!< The type the pawn was promoted to
-					(If a PROMOTION movetype was made,
-					otherwise the value should be
-					#NO_PIECE_TYPE) */
-	Color color;			///< turn color
-	Square source;			///< Source square
-	Square destination;		///< Destination square
-} Move;
+///
+/// The move is packed into 16 bits: source square in bits 0-5, destination
+/// square in bits 6-11, #MoveType in bits 12-13 and the promotion piece type
+/// (counted from #KNIGHT) in bits 14-15. The moved piece and its color are
+/// taken from the board. Castling is encoded as the king move.
+typedef uint16_t Move;
+
+/// No move. A1A1 is never a legal move, so the zero value is free.
+#define MOVE_NONE ((Move)0)
+
+/// Null move for null move pruning, B1B1 is never a legal move either.
+#define MOVE_NULL ((Move)(SQ_B1 | (SQ_B1 << 6)))
+
+/**
+ * \brief Packs the move
+ *
+ * \param source source square
+ *
+ * \param destination destination square
+ *
+ * \param move_type #MoveType
+ *
+ * \param promotion_piece_type the type the pawn is promoted to, ignored
+ * unless move_type is #PROMOTION
+ *
+ * \return packed move
+ */
+static inline Move make_move(
+	Square source,
+	Square destination,
+	MoveType move_type,
+	PieceType promotion_piece_type
+)
+{
+	return (
+		source | (destination << 6) | (move_type << 12)
+		| (move_type == PROMOTION ? (promotion_piece_type - KNIGHT) << 14 : 0)
+	);
+}
+
+/// Returns source square of the move
+static inline Square source_of_move(Move move)
+{
+	return move & 63;
+}
+
+/// Returns destination square of the move
+static inline Square destination_of_move(Move move)
+{
+	return (move >> 6) & 63;
+}
+
+/// Returns #MoveType of the move
+static inline MoveType type_of_move(Move move)
+{
+	return (move >> 12) & 3;
+}
+
+/// Returns the type the pawn is promoted to or #NO_PIECE_TYPE if the move
+/// isn't a promotion
+static inline PieceType promotion_of_move(Move move)
+{
+	return (
+		type_of_move(move) == PROMOTION
+		? KNIGHT + (move >> 14) : NO_PIECE_TYPE
+	);
+}
 
 /// Bit flags that can be used to indicate the castling availability for each
 /// position
@@ -79,8 +135,12 @@ typedef union Board {
 /// Position state
 typedef struct PositionState {
 	Move previous_move;	///< Previous move
+	Color turn;		///< Side to move
+	Square en_passant;	/*!< En passant square, #SQ_NONE if the
+				previous move wasn't a double pawn push */
 	Castling castling;	///< Able castlings
-	uint32_t move_50_rule;	///< 50 move rule counter
+	uint32_t move_50_rule;	/*!< 50 move rule counter, plies since the
+				last capture or pawn move */
 
 	U64 allies;	///< bitboard of all ally pieces
 	U64 enemies;	///< bitboard of all enemy pieces
@@ -88,13 +148,36 @@ typedef struct PositionState {
 
 	Piece captured_piece;	///< The piece captured on the previous move
 
-	struct PositionState *previous_state;	///< previous position state
+	U64 key;	/*!< Zobrist key of the position, updated incrementally
+			by do_move() and do_null_move() */
 } PositionState;
 
+/// Value of PositionState::move_50_rule at which the game is drawn
+#define MOVE_50_RULE_LIMIT 100
+
+/// Capacity of the position state history: the moves of the game plus the
+/// moves made during the search.
+#define STATE_HISTORY_NB 1024
+
 /// Position definition
 typedef struct Position {
-	PositionState *state;		///< Position state
+	PositionState *state;		/*!< Current position state, points into
+					#state_history. The previous state is
+					always state - 1. */
 	Board board;			///< Board
+
+	/// Mailbox with the piece on every square, kept in sync with #board by
+	/// set_piece(), remove_piece() and move_piece()
+	Piece board_squares[SQ_NB];
+
+	/// Bitboards of all pieces of each color, kept in sync with #board the
+	/// same way. PositionState::allies and PositionState::enemies are read
+	/// from here.
+	U64 occupied_by[COLOR_NB];
+
+	/// Contiguous stack of position states. do_move() and do_null_move()
+	/// push a new state, undo_move() and undo_null_move() pop it.
+	PositionState state_history[STATE_HISTORY_NB];
 } Position;
 
 /// An enumeration indicating the type of check.
@@ -125,6 +208,42 @@ CheckType get_check_type(const Position *position);
  */
 Position* init_position(const char *fen);
 
+/**
+ * \brief Frees the position created by #init_position
+ *
+ * \param position position or NULL
+ */
+void free_position(Position *position);
+
+/**
+ * \brief Creates an independent copy of the position with the whole state
+ * history, so moves can be made and undone on both at the same time. Must be
+ * freed with #free_position.
+ *
+ * \param position position to copy
+ *
+ * \return pointer to the copy or NULL, when memory allocation failed
+ */
+Position *copy_position(const Position *position);
+
+/**
+ * \brief Returns true if the position occurred before. Only the states since
+ * the last capture, pawn move or null move are compared, no earlier position
+ * can repeat.
+ *
+ * \param position
+ */
+bool is_repetition(const Position *position);
+
+/**
+ * \brief Returns true if the position is a draw by repetition or by the 50
+ * move rule. The 50 move rule doesn't apply when the side to move is
+ * checkmated.
+ *
+ * \param position
+ */
+bool is_draw(Position *position);
+
 /**
  * \brief Returns a bitboard with all the pieces that attacked the square
  *
@@ -142,6 +261,25 @@ U64 attacked_by(
 	Color attackers_color
 );
 
+/**
+ * \brief Returns all the squares attacked by one side, computed in one pass:
+ * set-wise for pawns and knights and per piece for sliders.
+ *
+ * \param position
+ *
+ * \param attackers_color the color of the attackers
+ *
+ * \param occupied occupancy the sliders are blocked by, remove the enemy
+ * king from it to get the squares the king can't step on
+ *
+ * \return bitboard with the attacked squares
+ */
+U64 attacked_squares(
+	const Position *position,
+	Color attackers_color,
+	U64 occupied
+);
+
 /**
  * \brief Returns the bitboard of pieces on the board
  *
@@ -154,7 +292,8 @@ U64 attacked_by(
 U64 pieces(const Position *pos, Piece piece);
 
 /**
- * \brief Returns piece on target square
+ * \brief Returns piece on target square, a single lookup in
+ * Position::board_squares
  *
  * \param position
  *
@@ -208,7 +347,7 @@ void set_piece(Position *position, Piece piece, Square target);
 void remove_piece(Position *position, Piece piece, Square target);
 
 /**
- * \brief Castling the king
+ * \brief Castling the king. Updates the key of the current state.
  *
  * \param position
  *
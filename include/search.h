@@ -10,20 +10,103 @@
 #include "movegen.h"
 #include "hash.h"
 
-/// Counter for the number of nodes
-extern U64 nodes;
+#include <stdbool.h>
 
-/// Ply counter
-extern U64 ply;
+/// Max number of plies
+#define MAX_PLY 64
 
-/// PV flag that indicates do we follow PV line or not
-extern uint8_t follow_PV;
+/// Max number of search threads
+#define MAX_THREADS 256
 
-/// PV flag that indicates do we evaluate PV moves or not
-extern uint8_t eval_PV;
+/// Default half width of the aspiration windows
+#define ASPIRATION_DELTA 50
 
-/// Max number of plies
-#define MAX_PLY 64
+/// Max initial half width of the aspiration windows
+#define ASPIRATION_DELTA_MAX 1000
+
+/// Structure with fields for time control
+typedef struct TimeInfo {
+	uint8_t quit;
+	uint8_t time_set;
+	_Atomic uint8_t stopped;	///< Read by all the search threads
+
+	int moves_to_go;
+	int inc;
+
+	int start_time;
+	int stop_time;
+
+	int move_time;
+	int time_uci;
+} TimeInfo;
+
+/// Search state of one thread. The threads of the Lazy SMP search share only
+/// the transposition table, everything else the search writes is kept here.
+typedef struct SearchThread {
+	struct SearchContext *context;	///< Search the thread belongs to
+	Position *pos;			///< Own copy of the root position
+	uint32_t id;			///< 0 for the main thread
+	uint32_t depth;			///< Max depth to search
+
+	U64 nodes;			///< Counter for the number of nodes
+	U64 ply;			///< Ply counter
+
+	uint8_t follow_PV;		/*!< PV flag that indicates do we
+					follow PV line or not */
+
+	/// Two quiet moves per ply which caused a beta cutoff, the move picker
+	/// returns them right after the good captures
+	Move killer_moves[2][MAX_PLY];
+
+	/// History heuristic scores of quiet moves which caused a cutoff, used
+	/// by the move picker to order quiet moves
+	Evaluation history_moves[12][64];
+
+	/// Lenght of the principle variation table
+	uint32_t pv_lenght[MAX_PLY];
+
+	/// Principle variation table
+	Move pv_table[MAX_PLY][MAX_PLY];
+
+	/// Preallocated move lists, one for each ply, so that the search never
+	/// has to allocate a move list on its own
+	MoveList move_stack[MAX_PLY];
+} SearchThread;
+
+/// All the state of a search: time control, threads and statistics. Searches
+/// of different contexts may run at the same time, they share only the
+/// transposition table, which must not be resized or cleared meanwhile.
+typedef struct SearchContext {
+	TimeInfo time;			///< Time control of the search
+
+	bool uci;			/*!< The main thread reads the UCI stop
+					command and prints info lines */
+
+	uint32_t threads_nb;		///< Number of search threads
+	SearchThread *threads;		///< State of every search thread
+
+	Evaluation aspiration_delta;	/*!< Initial half width of the
+					aspiration windows, 0 disables them */
+
+	uint8_t generation;		/*!< Transposition table generation of
+					the running search */
+
+	U64 nodes;			///< Nodes of all the threads
+	uint32_t depth;			///< Last completed depth
+} SearchContext;
+
+/// Evaluation of the hash move, it is always searched first
+#define HASH_MOVE_EVAL 30000
+
+/**
+ * \brief Returns the row of SearchThread::history_moves of the piece
+ *
+ * \param piece piece, not #NO_PIECE
+ */
+static inline uint32_t history_index(Piece piece)
+{
+	return 6 * color_of_piece(piece) + type_of_piece(piece) - 1;
+}
 
 /// MVV LVA table
 static const Evaluation mvv_lva[6][6] = {
@@ -36,7 +119,68 @@ static const Evaluation mvv_lva[6][6] = {
 };
 
 /**
- * \brief Returns the best move according to the chess engine
+ * \brief Initializes the table of late move reductions
+ */
+void init_reductions(void);
+
+/**
+ * \brief Resets the time control to a search without time limit
+ *
+ * \param time_info time control
+ */
+void init_time_info(TimeInfo *time_info);
+
+/**
+ * \brief Creates a search context without time limit which doesn't read the
+ * input and doesn't print anything. Must be freed with #free_search_context.
+ *
+ * \param threads_nb number of search threads, 1 to #MAX_THREADS
+ *
+ * \return pointer to the context or NULL, when memory allocation failed
+ */
+SearchContext *init_search_context(uint32_t threads_nb);
+
+/**
+ * \brief Frees the search context
+ *
+ * \param context search context
+ */
+void free_search_context(SearchContext *context);
+
+/**
+ * \brief Changes the number of search threads of the context
+ *
+ * \param context search context, not searching at the moment
+ *
+ * \param threads_nb number of search threads, 1 to #MAX_THREADS
+ *
+ * \return false if memory allocation failed, the context is left as it was
+ */
+bool set_search_threads(SearchContext *context, uint32_t threads_nb);
+
+/**
+ * \brief Resets the search state of the thread
+ *
+ * \param thread search thread
+ *
+ * \param context search context the thread belongs to
+ *
+ * \param pos position searched by the thread, owned by the caller
+ *
+ * \param id thread index, only the main thread with index 0 reads the input
+ * and prints the search info
+ */
+void init_search_thread(
+	SearchThread *thread, SearchContext *context,
+	Position *pos, uint32_t id
+);
+
+/**
+ * \brief Returns the best move according to the chess engine. The main thread
+ * is helped by SearchContext::threads_nb - 1 threads searching copies of the
+ * position, see https://www.chessprogramming.org/Lazy_SMP
+ *
+ * \param context search context, SearchContext::time must be set before
  *
  * \param position position
  *
@@ -44,37 +188,35 @@ static const Evaluation mvv_lva[6][6] = {
  *
  * \return #ExtMove with the evaluation and the move
  */
-ExtMove find_best(Position *position, uint32_t depth);
+ExtMove find_best(
+	SearchContext *context, Position *position, uint32_t depth
+);
 
 /**
  * \brief Sorts moves from the strongest to the weakest.
  *
- * \param pos current position
+ * \param thread search thread with the current position
  *
  * \param move_list move list
+ *
+ * \param hash_move best move from the transposition table, it is placed
+ * first
  */
-void sort_move_list(Position *pos, MoveList *move_list);
+void sort_move_list(SearchThread *thread, MoveList *move_list, Move hash_move);
 
 /**
  * \brief Evaluates the given move.
  *
- * \param pos current position
+ * \param thread search thread with the current position
  *
  * \param move move to be evaluated
  */
-void evaluate_move(Position *pos, ExtMove *move);
-
-/**
- * \brief Evaluates pv moves in move list
- *
- * \param move_list move list
- */
-void complete_pv_evaluation(MoveList *move_list);
+void evaluate_move(SearchThread *thread, ExtMove *move);
 
 /**
  * \brief Function which realises quiescence search algorithm.
  *
- * \param pos current position
+ * \param thread search thread with the current position
  *
  * \param alpha alpha value
  *
@@ -84,13 +226,16 @@ void complete_pv_evaluation(MoveList *move_list);
  *
  * \see https://www.chessprogramming.org/Quiescence_Search
  */
-Evaluation quiescence(Position *pos, Evaluation alpha, Evaluation beta);
+Evaluation quiescence(
+	SearchThread *thread,
+	Evaluation alpha, Evaluation beta
+);
 
 /**
  * \brief Negamax algorithm which returns the best evaluation of the given
  * position.
  *
- * \param pos current position
+ * \param thread search thread with the current position
  *
  * \param depth search depth
  *
@@ -101,7 +246,7 @@ Evaluation quiescence(Position *pos, Evaluation alpha, Evaluation beta);
  * \return best evaluation of the given position
  */
 Evaluation negamax(
-	Position *pos, uint32_t depth,
+	SearchThread *thread, uint32_t depth,
 	Evaluation alpha, Evaluation beta
 );
 
@@ -0,0 +1,147 @@
+/**
+ * \file
+ */
+#ifndef __TRANSPOSITION_H__
+#define __TRANSPOSITION_H__
+
+#include "bitboard.h"
+#include "position.h"
+#include "evaluate.h"
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/// Default size of the transposition table in megabytes
+#define TT_DEFAULT_SIZE 16
+
+/// Maximal size of the transposition table in megabytes
+#define TT_MAX_SIZE 65536
+
+/// Number of entries in one bucket, a bucket fills one cache line
+#define TT_BUCKET_SIZE 4
+
+/// Indicates how the stored score relates to the real score of the position
+typedef enum Bound {
+	BOUND_NONE = 0,		///< Empty entry
+	BOUND_UPPER = 1,	///< Fail low, the real score is <= stored score
+	BOUND_LOWER = 2,	///< Fail high, the real score is >= stored score
+	BOUND_EXACT = BOUND_UPPER | BOUND_LOWER,	///< Exact score
+} Bound;
+
+/// Content of a transposition table entry, unpacked by tt_probe()
+typedef struct TTData {
+	int32_t score;		///< Score, mate scores are relative to the node
+	Move move;		///< Best move or #MOVE_NONE
+	uint8_t depth;		///< Depth of the search that produced the entry
+	uint8_t bound_age;	/*!< #Bound in the two low bits, generation of
+				the search in the six high bits */
+} TTData;
+
+/// Transposition table entry, shared by all the search threads. The data
+/// packs #TTData into one word and the key is stored xor-ed with it, so an
+/// entry torn by two threads writing at the same time fails the key check
+/// and no lock is needed.
+/// \see https://www.chessprogramming.org/Transposition_Table
+/// \see https://www.chessprogramming.org/Shared_Hash_Table#Lockless
+typedef struct TTEntry {
+	_Atomic U64 key_xor_data;	///< Zobrist key xor data
+	_Atomic U64 data;		///< Packed #TTData
+} TTEntry;
+
+/// Set of entries sharing the same index. Aligned to the cache line, so a
+/// probe touches only one line.
+typedef struct TTBucket {
+	TTEntry entries[TT_BUCKET_SIZE];	///< Entries
+} TTBucket;
+
+/// Transposition table, shared by all the searches of the process
+typedef struct TranspositionTable {
+	TTBucket *buckets;	///< Cache line aligned array of buckets
+	U64 bucket_count;	///< Number of buckets, always a power of two
+
+	_Atomic uint8_t generation;	///< Generation of the last search
+	_Atomic uint32_t searches;	/*!< Number of the running searches,
+					the table can't be resized or cleared
+					while there are any */
+
+	void *memory;		///< Allocated memory, #buckets points into it
+} TranspositionTable;
+
+/// Global transposition table
+extern TranspositionTable tt;
+
+/// Returns #Bound of the #TTData
+#define tt_bound(entry) ((Bound)((entry)->bound_age & 3))
+
+/**
+ * \brief Allocates the transposition table. The old table is freed and all
+ * the entries are lost.
+ *
+ * \param megabytes size of the table, the real size is rounded down to a
+ * power of two buckets
+ *
+ * \return false if a search is running, the table is left as it was, or
+ * if memory allocation failed, the table is empty then
+ */
+bool tt_resize(size_t megabytes);
+
+/**
+ * \brief Frees the transposition table
+ */
+void tt_free(void);
+
+/**
+ * \brief Removes all entries from the transposition table. Must not be
+ * called while a search is running.
+ */
+void tt_clear(void);
+
+/**
+ * \brief Starts a new search, which must be finished by tt_end_search().
+ * Entries of the previous searches become older and are replaced first.
+ * Searches of several contexts may run at the same time, each of them
+ * stores its entries with its own generation.
+ *
+ * \return generation of the new search
+ */
+uint8_t tt_new_search(void);
+
+/**
+ * \brief Finishes the search started by tt_new_search()
+ */
+void tt_end_search(void);
+
+/**
+ * \brief Looks for the position in the transposition table
+ *
+ * \param key zobrist key of the position
+ *
+ * \param data out parameter, copy of the entry
+ *
+ * \return true if the position is stored, data is set only then
+ */
+bool tt_probe(U64 key, TTData *data);
+
+/**
+ * \brief Stores search result in the transposition table. Replaces the entry
+ * with the same key, an empty entry, or the shallowest and oldest entry of
+ * the bucket.
+ *
+ * \param key zobrist key of the position
+ *
+ * \param depth search depth
+ *
+ * \param bound #Bound of the score
+ *
+ * \param score score of the position
+ *
+ * \param move best move or #MOVE_NONE
+ *
+ * \param generation generation of the search, returned by tt_new_search()
+ */
+void tt_store(
+	U64 key, uint32_t depth, Bound bound,
+	Evaluation score, Move move, uint8_t generation
+);
+
+#endif
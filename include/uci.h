@@ -6,29 +6,11 @@
 
 #include "position.h"
 #include "evaluate.h"
+#include "search.h"
 
 /// Start position macro
 #define STARTPOS "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 
-/// Structure with fields for time control
-typedef struct TimeInfo {
-	uint8_t quit;
-	uint8_t time_set;
-	uint8_t stopped;
-
-	int moves_to_go;
-	int inc;
-
-	int start_time;
-	int stop_time;
-
-	int move_time;
-	int time_uci;
-} TimeInfo;
-
-/// Structure for time control
-extern TimeInfo time_info;
-
 /**
  * \brief Gets current time in milliseconds
  *
@@ -45,13 +27,18 @@ int input_waiting(void);
 
 /**
  * \brief Reads user\GUI input from STDIN
+ *
+ * \param time_info time control of the search, stopped by any input
  */
-void read_input(void);
+void read_input(TimeInfo *time_info);
 
 /**
- * \brief Bridge function to interact between search and user\GUI input
+ * \brief Bridge function to interact between search and user\GUI input.
+ * Stops the search when the time is up, reads the input only in the UCI mode.
+ *
+ * \param context search context
  */
-void communicate(void);
+void communicate(SearchContext *context);
 
 /**
  * \brief Converts a given string to a move.
@@ -86,13 +73,28 @@ Position *get_position(char *str);
  * \brief Starts calculating the best move at the given position within the
  * given depth.
  *
+ * \param context search context, its time control is set by the command
+ *
  * \param pos current position
  *
  * \param str string in the UCI format
  *
  * \return best move #ExtMove
  */
-ExtMove get_go(Position *pos, char *str);
+ExtMove get_go(SearchContext *context, Position *pos, char *str);
+
+/**
+ * \brief Handles UCI setoption command. Supported options:
+ * - Hash, size of the transposition table in megabytes
+ * - Threads, number of search threads, also used by go perft
+ * - AspirationDelta, initial half width of the aspiration windows
+ * - PerftHash, size of the perft hash table in megabytes
+ *
+ * \param context search context
+ *
+ * \param command string in the UCI format
+ */
+void set_option(SearchContext *context, char *command);
 
 /**
  * \brief Main UCI loop.
@@ -0,0 +1,27 @@
+#include "byteboard.h"
+#include "rays.h"
+#include "patterns.h"
+#include "masks.h"
+#include "hash.h"
+#include "perft.h"
+#include "search.h"
+#include "transposition.h"
+
+bool byteboard_init(size_t hash_megabytes)
+{
+	init_hash_keys();
+
+	init_rays();
+	init_patterns();
+	init_slider_attacks();
+
+	init_reductions();
+
+	return tt_resize(hash_megabytes);
+}
+
+void byteboard_free(void)
+{
+	tt_free();
+	perft_table_free();
+}
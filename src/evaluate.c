@@ -65,7 +65,7 @@ Evaluation evaluate_position(const Position *pos)
 {
 	assert(pos != NULL);
 
-	if(pos->state->move_50_rule == 50)
+	if(pos->state->move_50_rule >= MOVE_50_RULE_LIMIT)
 		return DRAW;
 
 	int32_t phase = get_phase(pos);
@@ -154,7 +154,7 @@ Evaluation evaluate_mobility(const Position *pos, GamePhase gp)
 	while(w_tmp) {
 		Square target = bit_scan_forward(w_tmp);
 
-		eval += population_count(knight_move_pattern(target)) * 4;
+		eval += population_count(knight_attacks[target]) * 4;
 
 		remove_lsb(w_tmp);
 	}
@@ -162,7 +162,7 @@ Evaluation evaluate_mobility(const Position *pos, GamePhase gp)
 	while(b_tmp) {
 		Square target = bit_scan_forward(b_tmp);
 
-		eval -= population_count(knight_move_pattern(target)) * 4;
+		eval -= population_count(knight_attacks[target]) * 4;
 
 		remove_lsb(b_tmp);
 	}
@@ -211,6 +211,99 @@ Evaluation evaluate_mobility(const Position *pos, GamePhase gp)
 	return eval;
 }
 
+/**
+ * \brief Returns the least valuable piece of the attackers and its type
+ */
+static U64 least_valuable_attacker(
+	const Position *pos,
+	U64 attackers,
+	Color color,
+	PieceType *pt
+)
+{
+	for (*pt = PAWN; *pt <= KING; (*pt)++) {
+		U64 subset = attackers & pieces(pos, make_piece(color, *pt));
+
+		if (subset)
+			return subset & -subset;
+	}
+
+	return EMPTY;
+}
+
+Evaluation static_exchange(const Position *pos, Move move)
+{
+	assert(pos != NULL);
+	assert(type_of_move(move) == COMMON);
+
+	// The king is never captured, so it ends the exchange as a huge victim
+	static const Evaluation king_value = 10000;
+
+	const Square source = source_of_move(move);
+	const Square target = destination_of_move(move);
+
+	Evaluation gain[32];
+	uint32_t depth = 0;
+
+	PieceType victim = type_of_piece(piece_on(pos, target));
+	PieceType attacker = type_of_piece(piece_on(pos, source));
+	Color color = color_of_piece(piece_on(pos, source));
+
+	U64 occupied = pos->state->occupied;
+	U64 from = 1ULL << source;
+
+	const U64 diagonal = (
+		pieces(pos, W_BISHOP) | pieces(pos, B_BISHOP)
+		| pieces(pos, W_QUEEN) | pieces(pos, B_QUEEN)
+	);
+	const U64 linear = (
+		pieces(pos, W_ROOK) | pieces(pos, B_ROOK)
+		| pieces(pos, W_QUEEN) | pieces(pos, B_QUEEN)
+	);
+
+	U64 attackers = attacked_by(pos, target, WHITE)
+		| attacked_by(pos, target, BLACK);
+
+	gain[0] = victim != NO_PIECE_TYPE
+		? piece_type_value[MIDDLEGAME][victim - 1] : 0;
+
+	do {
+		depth++;
+
+		// Speculative value of the capture if the piece is recaptured
+		gain[depth] = (
+			attacker == KING
+			? king_value : piece_type_value[MIDDLEGAME][attacker - 1]
+		) - gain[depth - 1];
+
+		// Neither side can gain by continuing
+		if (-gain[depth - 1] < 0 && gain[depth] < 0)
+			break;
+
+		attackers ^= from;
+		occupied ^= from;
+
+		// X-ray attackers behind the piece that has just captured
+		attackers |= (
+			(bishop_attacks_mask(target, occupied) & diagonal)
+			| (rook_attacks_mask(target, occupied) & linear)
+		) & occupied;
+
+		color = !color;
+		from = least_valuable_attacker(
+			pos, attackers, color, &attacker
+		);
+	} while (from && depth < 31);
+
+	// Either side may stand pat instead of recapturing
+	while (--depth) {
+		if (gain[depth] > -gain[depth - 1])
+			gain[depth - 1] = -gain[depth];
+	}
+
+	return gain[0];
+}
+
 Evaluation evaluate_material(const Position *pos, GamePhase gp)
 {
 	assert(pos != NULL);
@@ -372,7 +465,7 @@ Evaluation tempo(const Position *position)
 {
 	assert(position != NULL);
 
-	return 25 * (position->state->previous_move.color ? 1 : -1);
+	return 25 * (position->state->turn ? -1 : 1);
 }
 
 Evaluation evaluate_space(const Position *position)
@@ -396,14 +489,14 @@ Evaluation evaluate_space(const Position *position)
 		Square target = bit_scan_forward(white_pawns);
 		remove_lsb(white_pawns);
 
-		black_space_mask &= ~(pawn_attack_pattern[WHITE](target));
+		black_space_mask &= ~(pawn_attacks[WHITE][target]);
 	}
 
 	while(black_pawns) {
 		Square target = bit_scan_forward(black_pawns);
 		remove_lsb(black_pawns);
 
-		white_space_mask &= ~(pawn_attack_pattern[BLACK](target));
+		white_space_mask &= ~(pawn_attacks[BLACK][target]);
 	}
 
 	eval += (
@@ -10,62 +10,44 @@
 #include <stdlib.h>
 
 U64 side_key = 0;
-U64 hash_hey = 0;
 
 U64 piece_keys[12][64];
-U64 en_passant_keys[64];
+U64 en_passant_keys[8];
 U64 castling_keys[16];
 
-/// Seed for init hash keys
-uint32_t random_state = 1804289383;
+/// Seed of the key generator, keys are the same on every run
+#define RANDOM_SEED 0x2545F4914F6CDD1DULL
 
-uint32_t get_random_U32_number(void)
-{
-	uint32_t number = random_state;
-
-	number ^= number << 13;
-	number ^= number >> 17;
-	number ^= number << 5;
-
-	random_state = number;
-
-	return number;
-}
+/// State of the key generator
+U64 random_state = RANDOM_SEED;
 
 U64 get_random_U64_number(void)
 {
-    U64 n1, n2, n3, n4;
+	// splitmix64, every output bit depends on all the bits of the state
+	U64 number = (random_state += 0x9E3779B97F4A7C15ULL);
 
-    n1 = (U64)(get_random_U32_number()) & 0xFFFF;
-    n2 = (U64)(get_random_U32_number()) & 0xFFFF;
-    n3 = (U64)(get_random_U32_number()) & 0xFFFF;
-    n4 = (U64)(get_random_U32_number()) & 0xFFFF;
+	number = (number ^ (number >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	number = (number ^ (number >> 27)) * 0x94D049BB133111EBULL;
 
-    return n1 | (n2 << 16) | (n3 << 32) | (n4 << 48);
+	return number ^ (number >> 31);
 }
 
 void init_hash_keys(void)
 {
+	random_state = RANDOM_SEED;
+
 	for (uint32_t i = 0; i < 12; i++) {
 		for (Square sq = SQ_A1; sq < SQ_NB; sq++)
 			piece_keys[i][sq] = get_random_U64_number();
 	}
 
-	for (Square sq = SQ_A1; sq < SQ_NB; sq++)
-		en_passant_keys[sq] = get_random_U64_number();
+	for (uint32_t file = 0; file < 8; file++)
+		en_passant_keys[file] = get_random_U64_number();
 
 	side_key = get_random_U64_number();
 
-	castling_keys[NO_CASTLING] = get_random_U64_number();
-	castling_keys[WHITE_OO] = get_random_U64_number();
-	castling_keys[WHITE_OOO] = get_random_U64_number();
-	castling_keys[BLACK_OO] = get_random_U64_number();
-	castling_keys[BLACK_OOO] = get_random_U64_number();
-	castling_keys[KING_SIDE] = get_random_U64_number();
-	castling_keys[QUEEN_SIDE] = get_random_U64_number();
-	castling_keys[ALL_WHITE] = get_random_U64_number();
-	castling_keys[ALL_BLACK] = get_random_U64_number();
-	castling_keys[ALL_CASTLING] = get_random_U64_number();
+	for (Castling castling = NO_CASTLING; castling <= ALL_CASTLING; castling++)
+		castling_keys[castling] = get_random_U64_number();
 }
 
 U64 generate_hash_key(const Position *pos)
@@ -86,20 +68,11 @@ U64 generate_hash_key(const Position *pos)
 		}
 	}
 
-	Square dst = pos->state->previous_move.destination;
-	Square src = pos->state->previous_move.source;
-
-	if (
-		pos->state->previous_move.moved_piece_type == PAWN &&
-		(dst > src ? dst - src : src - dst) == 16
-	)
-		final_key ^= en_passant_keys[(
-			dst > src ? dst - 8 : src - 8
-		)];
+	final_key ^= en_passant_key(pos->state->en_passant);
 
 	final_key ^= castling_keys[pos->state->castling];
 
-	if ((!pos->state->previous_move.color) == BLACK)
+	if (pos->state->turn == BLACK)
 		final_key ^= side_key;
 
 	return final_key;
@@ -3,9 +3,96 @@
 #include "piece.h"
 #include "patterns.h"
 #include "rays.h"
+#include "masks.h"
 
 #include <assert.h>
 
+#if defined(USE_PEXT) && defined(__BMI2__)
+	#include <immintrin.h>
+#endif
+
+Magic rook_magics[SQ_NB];
+Magic bishop_magics[SQ_NB];
+
+/// Shared attack table for all rook squares
+static U64 rook_attacks_table[0x19000];
+/// Shared attack table for all bishop squares
+static U64 bishop_attacks_table[0x1480];
+
+/// Magic factors for rooks, found by trial and error with sparse random
+/// numbers
+static const U64 rook_magic_numbers[SQ_NB] = {
+	0x1080004008801020ULL, 0x0840092002C03000ULL,
+	0x1900200010400900ULL, 0x0880100008000480ULL,
+	0x4200100420080200ULL, 0x8100020100080400ULL,
+	0x0200040110886200ULL, 0x0200008040220411ULL,
+	0x0404800084400220ULL, 0x0000401000402000ULL,
+	0x0086001081220440ULL, 0x0408800800100280ULL,
+	0x000A001201040820ULL, 0x8848800200840080ULL,
+	0x4001000100040200ULL, 0x0442000102105084ULL,
+	0x9080010020804100ULL, 0x0040404000201009ULL,
+	0x0000808010002009ULL, 0x2200090021D00100ULL,
+	0x0008008008040080ULL, 0x0004004002010040ULL,
+	0x0011040008015042ULL, 0x00000A0001768104ULL,
+	0x0000800080204009ULL, 0x2010004140002001ULL,
+	0x9800200280100080ULL, 0x1000100080080080ULL,
+	0x0442000A00049020ULL, 0x2100040080020080ULL,
+	0x0800120400900148ULL, 0x0010040A00128541ULL,
+	0x2800804000800030ULL, 0x1010002000400041ULL,
+	0x4000200011004100ULL, 0x0610008410800800ULL,
+	0x0400802402800800ULL, 0xC100020080800400ULL,
+	0x0002000802000401ULL, 0x0182085882000401ULL,
+	0x0220204000808000ULL, 0x2860100040024022ULL,
+	0x0001002004110040ULL, 0x99101042000A0020ULL,
+	0x0004080004008080ULL, 0x0010040002008080ULL,
+	0x2012004881020004ULL, 0x8300842444820011ULL,
+	0x0088403882010200ULL, 0x0820400080210100ULL,
+	0x0110910040A00300ULL, 0x0801100280080480ULL,
+	0x0242009008200600ULL, 0x1002000489500200ULL,
+	0x0040800200010080ULL, 0x0091800041000080ULL,
+	0x0000209300488001ULL, 0x04C1002414824001ULL,
+	0x020020000B001041ULL, 0x7000100004200901ULL,
+	0x8002002004100802ULL, 0x30010002084C0007ULL,
+	0x0888221800813004ULL, 0x4000002840840112ULL,
+};
+
+/// Magic factors for bishops, found by trial and error with sparse random
+/// numbers
+static const U64 bishop_magic_numbers[SQ_NB] = {
+	0xA010041108003100ULL, 0x006082020A002900ULL,
+	0x6810010619200000ULL, 0x08281A0520000408ULL,
+	0x0001104001000400ULL, 0x0018901008048400ULL,
+	0x00040A0210245280ULL, 0x000200210808A402ULL,
+	0x9140048410821200ULL, 0x0800091010820041ULL,
+	0x20504804832202C0ULL, 0x0100091401081000ULL,
+	0x8021011140000012ULL, 0x0810020804450400ULL,
+	0x208B0542109008A2ULL, 0x0080084A08040204ULL,
+	0x0040E2A80811244CULL, 0x2505022008008108ULL,
+	0x0430220100420040ULL, 0x010A040420220040ULL,
+	0x1105000290400000ULL, 0x0093001200822120ULL,
+	0x4000A62048043004ULL, 0x280120048A015004ULL,
+	0x006090002A020814ULL, 0x44042000240800D0ULL,
+	0x01102800040A4400ULL, 0x1004080080220040ULL,
+	0x0001001011004024ULL, 0x0010044000805040ULL,
+	0x0914041200820100ULL, 0x0004821012821480ULL,
+	0x0024040500C05021ULL, 0x0088611002080200ULL,
+	0x0116080A00040020ULL, 0x4000020080080080ULL,
+	0x2450450140840040ULL, 0x0000880201484100ULL,
+	0x0222020404020092ULL, 0x8081110600002E00ULL,
+	0x2842101105000801ULL, 0x1100809008001025ULL,
+	0x00020202221C0400ULL, 0x0422014022009020ULL,
+	0x0210046102100C00ULL, 0xC004008082029102ULL,
+	0x00AA461801101200ULL, 0x0404080080201108ULL,
+	0x020542108C205002ULL, 0x0410544804100100ULL,
+	0x0040910841100000ULL, 0x0400200042021100ULL,
+	0x00004204850400C0ULL, 0x0200100410A42102ULL,
+	0x1040020801210102ULL, 0x0805040410420000ULL,
+	0x2884804130100200ULL, 0x800C262201242000ULL,
+	0x1058000194108800ULL, 0x0014221054420204ULL,
+	0x0104000012A02200ULL, 0x0200881003300100ULL,
+	0x0140400202840100ULL, 0x0402020801010201ULL,
+};
+
 
 U64 pawn_move_mask(Square target, U64 occupied, Color color)
 {
@@ -27,7 +114,7 @@ U64 pawn_attack_mask(Square target, U64 occupied, Color color)
 	assert(occupied != EMPTY);
 	assert(color < COLOR_NB);
 
-	return pawn_attack_pattern[color](target) & occupied;
+	return pawn_attacks[color][target] & occupied;
 }
 
 U64 pawn_mask(Square target, U64 occupied, Color color)
@@ -42,7 +129,7 @@ U64 pawn_mask(Square target, U64 occupied, Color color)
 	);
 }
 
-U64 rook_attacks_mask(Square target, U64 occupied)
+U64 rook_ray_attacks_mask(Square target, U64 occupied)
 {
 	assert(target < SQ_NB);
 
@@ -82,7 +169,7 @@ U64 rook_attacks_mask(Square target, U64 occupied)
 	return south_ray_mask | north_ray_mask | east_ray_mask | west_ray_mask;
 }
 
-U64 bishop_attacks_mask(Square target, U64 occupied)
+U64 bishop_ray_attacks_mask(Square target, U64 occupied)
 {
 	assert(target < SQ_NB);
 
@@ -121,6 +208,112 @@ U64 bishop_attacks_mask(Square target, U64 occupied)
 	return north_east_ray | north_west_ray | south_east_ray | south_west_ray;
 }
 
+/**
+ * \brief Returns the index of the occupancy in the attack table of the
+ * square.
+ *
+ * \param magic magic entry of the square
+ *
+ * \param occupied bitboard with chess pieces
+ */
+static inline uint32_t magic_index(const Magic *magic, U64 occupied)
+{
+#if defined(USE_PEXT) && defined(__BMI2__)
+	return _pext_u64(occupied, magic->mask);
+#else
+	return ((occupied & magic->mask) * magic->magic) >> magic->shift;
+#endif
+}
+
+/**
+ * \brief Fills magic entries and the attack table for one slider type.
+ *
+ * \param magics magic entries to fill
+ *
+ * \param table shared attack table
+ *
+ * \param magic_numbers magic factor for each square
+ *
+ * \param get_attacks slow attack function used to fill the table
+ */
+static void init_magics(
+	Magic magics[SQ_NB],
+	U64 *table,
+	const U64 magic_numbers[SQ_NB],
+	U64 (*get_attacks)(Square target, U64 occupied)
+)
+{
+	U64 *attacks = table;
+
+	for(Square sq = SQ_A1; sq < SQ_NB; sq++) {
+		U64 edges = (
+			((RANK_1 | RANK_8) & ~ranks[rank_of(sq)])
+			| ((FILE_A | FILE_H) & ~files[file_of(sq)])
+		);
+
+		Magic *magic = &magics[sq];
+
+		magic->mask = get_attacks(sq, EMPTY) & ~edges;
+		magic->magic = magic_numbers[sq];
+		magic->shift = 64 - population_count(magic->mask);
+		magic->attacks = attacks;
+
+		// Enumerate all subsets of the mask
+		// \see https://www.chessprogramming.org/Traversing_Subsets_of_a_Set
+		U64 occupied = EMPTY;
+
+		do {
+			U64 *entry = &magic->attacks[magic_index(magic, occupied)];
+
+			assert(
+				*entry == EMPTY
+				|| *entry == get_attacks(sq, occupied)
+			);
+
+			*entry = get_attacks(sq, occupied);
+
+			occupied = (occupied - magic->mask) & magic->mask;
+		} while(occupied);
+
+		attacks += 1ULL << (64 - magic->shift);
+	}
+}
+
+void init_slider_attacks(void)
+{
+	init_magics(
+		rook_magics,
+		rook_attacks_table,
+		rook_magic_numbers,
+		rook_ray_attacks_mask
+	);
+
+	init_magics(
+		bishop_magics,
+		bishop_attacks_table,
+		bishop_magic_numbers,
+		bishop_ray_attacks_mask
+	);
+}
+
+U64 rook_attacks_mask(Square target, U64 occupied)
+{
+	assert(target < SQ_NB);
+
+	const Magic *magic = &rook_magics[target];
+
+	return magic->attacks[magic_index(magic, occupied)];
+}
+
+U64 bishop_attacks_mask(Square target, U64 occupied)
+{
+	assert(target < SQ_NB);
+
+	const Magic *magic = &bishop_magics[target];
+
+	return magic->attacks[magic_index(magic, occupied)];
+}
+
 U64 queen_attacks_mask(Square target, U64 occupied)
 {
 	assert(target < SQ_NB);
@@ -27,26 +27,20 @@ MoveList *init_move_list(void)
 
 void add_common_moves(
 	MoveList *move_list,
-	Piece piece,
 	Square source,
 	U64 destinations
 )
 {
 	assert(move_list != NULL);
 	assert(source < SQ_NB);
-	assert(piece != NO_PIECE);
 
-	Move move = {
-		.move_type = COMMON, .moved_piece_type = type_of_piece(piece),
-		.promotion_piece_type = NO_PIECE_TYPE,
-		.color = color_of_piece(piece),
-		.source = source
-	};
-
-	ExtMove ext_move = {.move = move, .eval = NO_EVAL};
+	ExtMove ext_move = {.move = MOVE_NONE, .eval = NO_EVAL};
 
 	while (destinations) {
-		ext_move.move.destination = bit_scan_forward(destinations);
+		ext_move.move = make_move(
+			source, bit_scan_forward(destinations),
+			COMMON, NO_PIECE_TYPE
+		);
 
 		ml_add(move_list, ext_move);
 
@@ -63,16 +57,13 @@ void add_castlings(
 	assert(move_list != NULL);
 	assert(source < SQ_NB);
 
-	Move move = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE,
-		.color = source == SQ_E8, .source = source
-	};
-
-	ExtMove ext_move = {.move = move, .eval = NO_EVAL};
+	ExtMove ext_move = {.move = MOVE_NONE, .eval = NO_EVAL};
 
 	while (destinations) {
-		ext_move.move.destination = bit_scan_forward(destinations);
+		ext_move.move = make_move(
+			source, bit_scan_forward(destinations),
+			CASTLING, NO_PIECE_TYPE
+		);
 
 		ml_add(move_list, ext_move);
 
@@ -80,31 +71,30 @@ void add_castlings(
 	}
 }
 
-void add_promotions(
+/**
+ * \brief Adds promotions into the pieces from first to last piece type for
+ * every destination.
+ */
+static void add_promotions_range(
 	MoveList *move_list,
-	Color color,
 	Square source,
-	U64 destinations
+	U64 destinations,
+	PieceType first,
+	PieceType last
 )
 {
 	assert(move_list != NULL);
 	assert(source < SQ_NB);
-	assert(color < COLOR_NB);
-
-	Move move = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.color = color, .source = source
-	};
 
-	ExtMove ext_move = {
-		.move = move, .eval = NO_EVAL
-	};
+	ExtMove ext_move = {.move = MOVE_NONE, .eval = NO_EVAL};
 
 	while (destinations) {
-		ext_move.move.destination = bit_scan_forward(destinations);
+		Square destination = bit_scan_forward(destinations);
 
-		for(PieceType pc_type = KNIGHT; pc_type < KING; pc_type++) {
-			ext_move.move.promotion_piece_type = pc_type;
+		for(PieceType pc_type = first; pc_type <= last; pc_type++) {
+			ext_move.move = make_move(
+				source, destination, PROMOTION, pc_type
+			);
 			ml_add(move_list, ext_move);
 		}
 
@@ -112,9 +102,17 @@ void add_promotions(
 	}
 }
 
+void add_promotions(
+	MoveList *move_list,
+	Square source,
+	U64 destinations
+)
+{
+	add_promotions_range(move_list, source, destinations, KNIGHT, QUEEN);
+}
+
 void add_en_passant(
 	MoveList *move_list,
-	Color color,
 	U64 sources,
 	Square destination
 )
@@ -122,20 +120,14 @@ void add_en_passant(
 	assert(move_list != NULL);
 	assert(destination < SQ_NB);
 	assert(population_count(sources) <= 2);
-	assert(color < COLOR_NB);
 
-	Move move = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE,
-		.color = color, .destination = destination
-	};
-
-	ExtMove ext_move = {
-		.move = move, .eval = NO_EVAL
-	};
+	ExtMove ext_move = {.move = MOVE_NONE, .eval = NO_EVAL};
 
 	while (sources) {
-		ext_move.move.source = bit_scan_forward(sources);
+		ext_move.move = make_move(
+			bit_scan_forward(sources), destination,
+			EN_PASSANT, NO_PIECE_TYPE
+		);
 
 		ml_add(move_list, ext_move);
 
@@ -143,6 +135,42 @@ void add_en_passant(
 	}
 }
 
+/**
+ * \brief Returns the squares the moves of the #GenType may land on. Pawn
+ * promotions and en passant are selected by the pawn generators themselves.
+ */
+static inline U64 gen_targets(const Position *pos, GenType type)
+{
+	if ((type & GEN_ALL) == GEN_CAPTURES)
+		return pos->state->enemies;
+
+	if ((type & GEN_ALL) == GEN_QUIETS)
+		return ~(pos->state->occupied);
+
+	return UNIVERSE;
+}
+
+/**
+ * \brief Same as filter_legal_moves(), but #GEN_PSEUDO_LEGAL leaves the pin
+ * ray to is_legal()
+ */
+static inline U64 filter_moves(
+	const Position *pos,
+	const CheckInfo *check_info,
+	GenType type,
+	Square source,
+	U64 destinations
+)
+{
+	if (type & GEN_PSEUDO_LEGAL)
+		return (
+			destinations & ~(pos->state->allies)
+			& check_info->check_ray
+		);
+
+	return filter_legal_moves(pos, check_info, source, destinations);
+}
+
 U64 king_safe_moves_mask(
 	Position *pos,
 	Square target,
@@ -153,84 +181,46 @@ U64 king_safe_moves_mask(
 	assert(target < SQ_NB);
 	assert(color < COLOR_NB);
 
-	U64 king_moves = king_move_pattern(target);
-
-	U64 linear = (
-		pieces(pos, make_piece(!color, ROOK))
-		| pieces(pos, make_piece(!color, QUEEN))
+	// The king doesn't block the sliders checking it along the ray
+	U64 attacked = attacked_squares(
+		pos, !color, pos->state->occupied ^ square_to_bitboard(target)
 	);
 
-	U64 diagonal = (
-		pieces(pos, make_piece(!color, BISHOP))
-		| pieces(pos, make_piece(!color, QUEEN))
-	);
+	return king_attacks[target] & ~(pos->occupied_by[color]) & ~attacked;
+}
 
-	U64 knights = pieces(pos, make_piece(!color, KNIGHT));
-	U64 pawns = pieces(pos, make_piece(!color, PAWN));
-	U64 king = pieces(pos, make_piece(!color, KING));
+/**
+ * \brief Returns the castlings whose squares are empty and not in the map of
+ * the squares attacked by the enemy
+ */
+static Castling castlings_by_attacks(
+	const Position *pos,
+	Color color,
+	U64 attacked
+)
+{
+	// Squares the king passes and the squares between the king and the
+	// rook, on the first rank
+	const U64 oo_path = 0x60ULL;
+	const U64 ooo_path = 0xCULL;
+	const U64 ooo_empty = 0xEULL;
 
+	uint32_t shift = color == WHITE ? 0 : 56;
 	U64 occupied = pos->state->occupied;
 
-	while (linear) {
-		U64 crossing_moves = rook_attacks_mask(
-			bit_scan_forward(linear),
-			occupied ^ square_to_bitboard(target)
-		) & king_moves;
-
-		king_moves &= ~(crossing_moves);
-
-		remove_lsb(linear);
-	}
-
-	while (diagonal) {
-		U64 crossing_moves = bishop_attacks_mask(
-			bit_scan_forward(diagonal),
-			occupied ^ square_to_bitboard(target)
-		) & king_moves;
-
-		king_moves &= ~(crossing_moves);
-
-		remove_lsb(diagonal);
-	}
-
-	while (knights) {
-		U64 crossing_moves = knight_move_pattern(
-			bit_scan_forward(knights)
-		) & king_moves;
-
-		king_moves &= ~(crossing_moves);
-
-		remove_lsb(knights);
-	}
-
-	while (pawns) {
-		U64 crossing_moves = pawn_attack_pattern[!color](
-			bit_scan_forward(pawns)
-		) & king_moves;
-
-		king_moves &= ~(crossing_moves);
-
-		remove_lsb(pawns);
-	}
-
-	while (king) {
-		U64 crossing_moves = king_move_pattern(
-			bit_scan_forward(king)
-		) & king_moves;
-
-		king_moves &= ~(crossing_moves);
+	bool oo = !((occupied | attacked) & (oo_path << shift));
+	bool ooo = !(
+		(occupied & (ooo_empty << shift))
+		| (attacked & (ooo_path << shift))
+	);
 
-		remove_lsb(king);
-	}
+	Castling cast = (
+		color == WHITE
+		? (oo * WHITE_OO) | (ooo * WHITE_OOO)
+		: (oo * BLACK_OO) | (ooo * BLACK_OOO)
+	);
 
-	return (
-		king_moves
-		^ pieces(pos, make_piece(color, PAWN))
-		^ pieces(pos, make_piece(color, KNIGHT))
-		^ pieces(pos, make_piece(color, BISHOP))
-		^ pieces(pos, make_piece(color, ROOK))
-		^ pieces(pos, make_piece(color, QUEEN))
-	) & king_moves;
+	return cast & pos->state->castling;
 }
 
 Castling possible_castlings(
@@ -241,58 +231,29 @@ Castling possible_castlings(
 	assert(pos != NULL);
 	assert(color < COLOR_NB);
 
-	Castling cast = NO_CASTLING;
-
-	if(color == WHITE) {
-		bool oo = !(
-			pos->state->occupied & 0x60ULL
-			|| attacked_by(pos, SQ_F1, BLACK)
-			|| attacked_by(pos, SQ_G1, BLACK)
-		);
-
-		bool ooo = !(
-			pos->state->occupied & 0xEULL
-			|| attacked_by(pos, SQ_D1, BLACK)
-			|| attacked_by(pos, SQ_C1, BLACK)
-		);
-
-		cast = (oo * WHITE_OO) | (ooo * WHITE_OOO);
-	} else {
-		bool oo = !(
-			pos->state->occupied & 0x6000000000000000ULL
-			|| attacked_by(pos, SQ_F8, WHITE)
-			|| attacked_by(pos, SQ_G8, WHITE)
-		);
-
-		bool ooo = !(
-			pos->state->occupied & 0xE00000000000000ULL
-			|| attacked_by(pos, SQ_D8, WHITE)
-			|| attacked_by(pos, SQ_C8, WHITE)
-		);
-
-		cast = (oo * BLACK_OO) | (ooo * BLACK_OOO);
-	}
-
-	return cast & pos->state->castling;
+	return castlings_by_attacks(
+		pos, color, attacked_squares(pos, !color, pos->state->occupied)
+	);
 }
 
-void generate_castlings(Position *pos, MoveList *move_list)
+/**
+ * \brief Adds the castlings of the side to move allowed by the map of the
+ * squares attacked by the enemy
+ */
+static void generate_castlings_by_attacks(
+	Position *pos,
+	MoveList *move_list,
+	U64 attacked
+)
 {
-	assert(pos != NULL);
-	assert(move_list != NULL);
-
-	Castling castlings = pos->state->castling;
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 
 	U64 rooks = pieces(pos, make_piece(color, ROOK));
 	U64 king = pieces(pos, make_piece(color, KING));
 
 	Square king_square = bit_scan_forward(king);
 
-	castlings &= possible_castlings(
-		pos,
-		color
-	);
+	Castling castlings = castlings_by_attacks(pos, color, attacked);
 
 	U64 destinations = 0x00ULL;
 
@@ -316,86 +277,136 @@ void generate_castlings(Position *pos, MoveList *move_list)
 	);
 }
 
-U64 filter_legal_moves(
-	Position *pos,
-	Square source,
-	U64 destinations,
-	U64 check_ray
-)
+void generate_castlings(Position *pos, MoveList *move_list)
 {
-	assert(source < SQ_NB);
 	assert(pos != NULL);
+	assert(move_list != NULL);
 
-	U64 source_bitboard = square_to_bitboard(source);
-	U64 allies = pos->state->allies;
-	U64 pinned = get_pinned(pos);
+	generate_castlings_by_attacks(
+		pos,
+		move_list,
+		attacked_squares(
+			pos, !(pos->state->turn), pos->state->occupied
+		)
+	);
+}
 
-	Color color = !pos->state->previous_move.color;
+void init_check_info(const Position *pos, CheckInfo *check_info)
+{
+	assert(pos != NULL);
+	assert(check_info != NULL);
 
-	destinations &= check_ray;
-	destinations &= ~(allies);
+	Color color = pos->state->turn;
 
-	if (source_bitboard & pinned) {
-		U64 king_bitboard = pieces(pos, make_piece(color, KING));
-		Square king = bit_scan_forward(king_bitboard);
+	U64 occupied = pos->state->occupied;
+	U64 allies = pos->state->allies;
 
-		U64 linear = (
-			pieces(pos, make_piece(!color, ROOK))
-			| pieces(pos, make_piece(!color, QUEEN))
-		);
+	Square king = bit_scan_forward(pieces(pos, make_piece(color, KING)));
+	Square enemy_king = bit_scan_forward(
+		pieces(pos, make_piece(!color, KING))
+	);
 
-		U64 diagonal = (
-			pieces(pos, make_piece(!color, BISHOP))
-			| pieces(pos, make_piece(!color, QUEEN))
-		);
+	U64 linear = (
+		pieces(pos, make_piece(!color, ROOK))
+		| pieces(pos, make_piece(!color, QUEEN))
+	);
 
-		U64 pinners = rook_attacks_mask(
-			king, pos->state->occupied ^ source_bitboard
-		) & linear;
+	U64 diagonal = (
+		pieces(pos, make_piece(!color, BISHOP))
+		| pieces(pos, make_piece(!color, QUEEN))
+	);
 
-		pinners |= bishop_attacks_mask(
-			king, pos->state->occupied ^ source_bitboard
-		) & diagonal;
+	check_info->king_square = king;
+	check_info->checkers = attacked_by(pos, king, !color);
+
+	if (check_info->checkers == EMPTY)
+		check_info->check_ray = UNIVERSE;
+	else if (population_count(check_info->checkers) == 1)
+		check_info->check_ray = ray_between[king][
+			bit_scan_forward(check_info->checkers)
+		] | check_info->checkers;
+	else
+		check_info->check_ray = EMPTY;
+
+	// Enemy sliders which see the king through ally pieces only. The ones
+	// with exactly one piece in between pin it.
+	U64 pinners = (
+		(rook_attacks_mask(king, occupied ^ allies) & linear)
+		| (bishop_attacks_mask(king, occupied ^ allies) & diagonal)
+	);
 
-		pinners ^= queen_attacks_mask(
-			king, pos->state->occupied
-		) & pinners;
+	check_info->pinned = EMPTY;
 
-		Square pinner = bit_scan_forward(attacked_by(
-			pos,
-			source,
-			!color
-		) & pinners);
+	while (pinners) {
+		Square pinner = bit_scan_forward(pinners);
+		U64 between = ray_between[king][pinner] & occupied;
 
-		U64 pin_ray = ray_between[king][pinner];
+		if (between && !(between & (between - 1))) {
+			check_info->pinned |= between;
+			check_info->pin_rays[bit_scan_forward(between)] = (
+				ray_between[king][pinner]
+				| square_to_bitboard(pinner)
+			);
+		}
 
-		destinations &= pin_ray | square_to_bitboard(pinner);
+		remove_lsb(pinners);
 	}
 
-	return destinations;
+	U64 bishop_checks = bishop_attacks_mask(enemy_king, occupied);
+	U64 rook_checks = rook_attacks_mask(enemy_king, occupied);
+
+	check_info->check_squares[NO_PIECE_TYPE] = EMPTY;
+	check_info->check_squares[PAWN] = pawn_attacks[!color][enemy_king];
+	check_info->check_squares[KNIGHT] = knight_attacks[enemy_king];
+	check_info->check_squares[BISHOP] = bishop_checks;
+	check_info->check_squares[ROOK] = rook_checks;
+	check_info->check_squares[QUEEN] = bishop_checks | rook_checks;
+	check_info->check_squares[KING] = EMPTY;
+}
+
+U64 filter_legal_moves(
+	const Position *pos,
+	const CheckInfo *check_info,
+	Square source,
+	U64 destinations
+)
+{
+	assert(source < SQ_NB);
+	assert(pos != NULL);
+	assert(check_info != NULL);
+
+	return (
+		destinations & ~(pos->state->allies)
+		& check_info->check_ray & pin_ray(check_info, source)
+	);
 }
 
 void generate_knight_moves(
-	MoveList *move_list, Position *pos, U64 check_ray
+	MoveList *move_list,
+	Position *pos,
+	const CheckInfo *check_info,
+	GenType type
 )
 {
 	assert(move_list != NULL);
 	assert(pos != NULL);
+	assert(check_info != NULL);
 
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 	U64 knights = pieces(pos, make_piece(color, KNIGHT));
 	U64 allies = pos->state->allies;
+	U64 check_ray = check_info->check_ray & gen_targets(pos, type);
 
-	knights &= ~(get_pinned(pos));
+	// A pinned knight can't move at all
+	knights &= ~(check_info->pinned);
 
 	while (knights) {
 		Square knight_sq = bit_scan_forward(knights);
 
 		add_common_moves(
 			move_list,
-			make_piece(color, KNIGHT),
 			knight_sq,
-			knight_move_pattern(knight_sq) & ~(allies) & check_ray
+			knight_attacks[knight_sq] & ~(allies) & check_ray
 		);
 
 		remove_lsb(knights);
@@ -403,13 +414,16 @@ void generate_knight_moves(
 }
 
 void generate_pawn_moves(
-	MoveList *move_list, Position *pos, U64 check_ray
+	MoveList *move_list,
+	Position *pos,
+	const CheckInfo *check_info,
+	GenType type
 )
 {
 	assert(move_list != NULL);
 	assert(pos != NULL);
 
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 
 	U64 pawns = pieces(pos, make_piece(color, PAWN));
 
@@ -419,147 +433,288 @@ void generate_pawn_moves(
 	generate_pawn_promotions(
 		move_list,
 		pos,
-		check_ray,
+		check_info,
+		type,
 		pawns_on_last_rank
 	);
 
-	generate_pawn_common(move_list, pos, check_ray, pawns);
+	generate_pawn_common(move_list, pos, check_info, type, pawns);
+
+	if (type & GEN_CAPTURES)
+		generate_pawn_en_passant(move_list, pos, check_info);
+}
+
+/**
+ * \brief Shifts the bitboard by the offset, towards the 8th rank for positive
+ * offsets and towards the 1st rank for negative ones
+ */
+static inline U64 shift_bitboard(U64 bitboard, int32_t offset)
+{
+	return offset > 0 ? bitboard << offset : bitboard >> -offset;
+}
+
+/**
+ * \brief Adds a common move for every destination, the source of each one is
+ * the destination minus the offset
+ */
+static void add_pawn_moves(
+	MoveList *move_list,
+	U64 destinations,
+	int32_t offset
+)
+{
+	ExtMove ext_move = {.move = MOVE_NONE, .eval = NO_EVAL};
+
+	while (destinations) {
+		Square destination = bit_scan_forward(destinations);
+
+		ext_move.move = make_move(
+			destination - offset, destination, COMMON, NO_PIECE_TYPE
+		);
+
+		ml_add(move_list, ext_move);
+
+		remove_lsb(destinations);
+	}
+}
 
-	generate_pawn_en_passant(move_list, pos, check_ray);
+/**
+ * \brief Adds the promotions of the #GenType for every destination, the
+ * source of each one is the destination minus the offset
+ */
+static void add_pawn_promotions(
+	MoveList *move_list,
+	GenType type,
+	U64 destinations,
+	int32_t offset
+)
+{
+	PieceType first = type & GEN_QUIETS ? KNIGHT : QUEEN;
+	PieceType last = type & GEN_CAPTURES ? QUEEN : ROOK;
+
+	while (destinations) {
+		Square destination = bit_scan_forward(destinations);
+
+		add_promotions_range(
+			move_list, destination - offset,
+			square_to_bitboard(destination), first, last
+		);
+
+		remove_lsb(destinations);
+	}
+}
+
+/**
+ * \brief Returns the legal destinations of a pinned pawn
+ */
+static inline U64 pinned_pawn_moves(
+	const Position *pos,
+	const CheckInfo *check_info,
+	Square source
+)
+{
+	return filter_legal_moves(
+		pos,
+		check_info,
+		source,
+		pawn_mask(source, pos->state->occupied, pos->state->turn)
+	);
 }
 
 void generate_pawn_common(
 	MoveList *move_list,
 	Position *position,
-	U64 check_ray,
+	const CheckInfo *check_info,
+	GenType type,
 	U64 pawns
 )
 {
 	assert(move_list != NULL);
 	assert(position != NULL);
 
-	Color color = !position->state->previous_move.color;
-	while(pawns) {
-		Square target = bit_scan_forward(pawns);
+	Color color = position->state->turn;
+	U64 targets = gen_targets(position, type) & check_info->check_ray;
 
-		U64 pawn_moves = pawn_mask(
-			target, position->state->occupied, color
-		);
+	// Pinned pawns may only move along their pin rays, one by one
+	if (!(type & GEN_PSEUDO_LEGAL)) {
+		U64 pinned = pawns & check_info->pinned;
 
-		pawn_moves = filter_legal_moves(
-			position,
-			target,
-			pawn_moves,
-			check_ray
-		);
+		pawns ^= pinned;
 
-		add_common_moves(
-			move_list,
-			make_piece(color, PAWN),
-			target,
-			pawn_moves
-		);
+		while (pinned) {
+			Square source = bit_scan_forward(pinned);
 
-		remove_lsb(pawns);
+			add_common_moves(
+				move_list,
+				source,
+				pinned_pawn_moves(position, check_info, source)
+				& targets
+			);
+
+			remove_lsb(pinned);
+		}
 	}
+
+	// The rest of the pawns move together, each set of destinations is
+	// the pawn bitboard shifted by the same offset
+	int32_t up = color == WHITE ? 8 : -8;
+
+	U64 empty = ~(position->state->occupied);
+	U64 enemies = position->state->enemies;
+
+	U64 single_pushes = shift_bitboard(pawns, up) & empty;
+	U64 double_pushes = shift_bitboard(
+		single_pushes & (color == WHITE ? RANK_3 : RANK_6), up
+	) & empty;
+
+	U64 west_captures = shift_bitboard(pawns & ~FILE_A, up - 1) & enemies;
+	U64 east_captures = shift_bitboard(pawns & ~FILE_H, up + 1) & enemies;
+
+	add_pawn_moves(move_list, single_pushes & targets, up);
+	add_pawn_moves(move_list, double_pushes & targets, 2 * up);
+	add_pawn_moves(move_list, west_captures & targets, up - 1);
+	add_pawn_moves(move_list, east_captures & targets, up + 1);
 }
 
 void generate_pawn_promotions(
 	MoveList *move_list,
 	Position *pos,
-	U64 check_ray,
+	const CheckInfo *check_info,
+	GenType type,
 	U64 pawns_on_last_rank
 )
 {
 	assert(move_list != NULL);
 	assert(pos != NULL);
 
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
+	U64 check_ray = check_info->check_ray;
 
-	while(pawns_on_last_rank) {
-		Square target = bit_scan_forward(pawns_on_last_rank);
+	U64 pawns = pawns_on_last_rank;
 
-		U64 destinations = pawn_mask(
-			target, pos->state->occupied, color
-		);
+	if (!(type & GEN_PSEUDO_LEGAL)) {
+		U64 pinned = pawns & check_info->pinned;
 
-		destinations = filter_legal_moves(
-			pos,
-			target,
-			destinations,
-			check_ray
-		);
+		pawns ^= pinned;
 
-		add_promotions(
-			move_list,
-			color,
-			target,
-			destinations
-		);
+		while (pinned) {
+			Square source = bit_scan_forward(pinned);
 
-		remove_lsb(pawns_on_last_rank);
+			U64 destinations = pinned_pawn_moves(
+				pos, check_info, source
+			);
+
+			while (destinations) {
+				Square destination = bit_scan_forward(
+					destinations
+				);
+
+				add_pawn_promotions(
+					move_list,
+					type,
+					square_to_bitboard(destination),
+					destination - source
+				);
+
+				remove_lsb(destinations);
+			}
+
+			remove_lsb(pinned);
+		}
 	}
+
+	int32_t up = color == WHITE ? 8 : -8;
+
+	U64 pushes = shift_bitboard(pawns, up) & ~(pos->state->occupied);
+	U64 west_captures = shift_bitboard(
+		pawns & ~FILE_A, up - 1
+	) & pos->state->enemies;
+	U64 east_captures = shift_bitboard(
+		pawns & ~FILE_H, up + 1
+	) & pos->state->enemies;
+
+	add_pawn_promotions(move_list, type, west_captures & check_ray, up - 1);
+	add_pawn_promotions(move_list, type, pushes & check_ray, up);
+	add_pawn_promotions(move_list, type, east_captures & check_ray, up + 1);
 }
 
 void generate_pawn_en_passant(
 	MoveList *move_list,
 	Position *pos,
-	U64 check_ray
+	const CheckInfo *check_info
 )
 {
 	assert(move_list != NULL);
 	assert(pos != NULL);
+	assert(check_info != NULL);
 
-	if(check_ray == EMPTY)
+	if(check_info->check_ray == EMPTY)
 		return;
 
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 
 	U64 pawns = pieces(pos, make_piece(color, PAWN));
 
-	Move prev_mv = pos->state->previous_move;
-	Square dst = prev_mv.destination;
-	Square src = prev_mv.source;
+	Square target = pos->state->en_passant;
 
-	U64 dst_bb = square_to_bitboard(dst);
+	if(target != SQ_NONE) {
+		// Square of the pawn which made the double push
+		Square dst = target - 8 + (16 * color);
+
+		U64 dst_bb = square_to_bitboard(dst);
 
-	if(
-		prev_mv.moved_piece_type == PAWN
-		&& (dst > src ? dst - src : src - dst) == 16
-	) {
 		U64 sources = (
 			(dst_bb & ~FILE_H) << 1 | (dst_bb & ~FILE_A) >> 1
 		) & pawns;
 
-		Square target = dst + 8 - (16 * color);
+		Square king_sq = check_info->king_square;
 
-		U64 tmp = sources;
+		U64 linear = (
+			pieces(pos, make_piece(!color, ROOK))
+			| pieces(pos, make_piece(!color, QUEEN))
+		);
 
-		while(tmp) {
-			U64 source = square_to_bitboard(
-				bit_scan_forward(sources)
-			);
+		U64 diagonal = (
+			pieces(pos, make_piece(!color, BISHOP))
+			| pieces(pos, make_piece(!color, QUEEN))
+		);
+
+		// Checks by knights and by pawns other than the captured one
+		// can't be resolved by en passant
+		if(
+			check_info->checkers & ~dst_bb & (
+				pieces(pos, make_piece(!color, KNIGHT))
+				| pieces(pos, make_piece(!color, PAWN))
+			)
+		)
+			return;
 
-			pos->state->occupied ^= dst_bb | source;
-			pos->state->allies ^= source;
-			pos->state->enemies ^= dst_bb;
+		U64 tmp = sources;
 
-			CheckType check_type = get_check_type(pos);
+		while(tmp) {
+			U64 source = square_to_bitboard(bit_scan_forward(tmp));
 
-			pos->state->occupied ^= dst_bb | source;
-			pos->state->allies ^= source;
-			pos->state->enemies ^= dst_bb;
+			// Both pawns leave their squares and the capturing pawn
+			// lands on the target square
+			U64 occupied = (
+				(pos->state->occupied ^ source ^ dst_bb)
+				| square_to_bitboard(target)
+			);
 
-			if(check_type) {
+			if(
+				(rook_attacks_mask(king_sq, occupied) & linear)
+				| (
+					bishop_attacks_mask(king_sq, occupied)
+					& diagonal
+				)
+			)
 				sources ^= source;
-			}
 
 			remove_lsb(tmp);
 		}
 
 		add_en_passant(
 			move_list,
-			color,
 			sources,
 			target
 		);
@@ -571,7 +726,8 @@ void generate_sliding_pieces(
 	MoveList *move_list,
 	Position *pos,
 	PieceType pt,
-	U64 check_ray,
+	const CheckInfo *check_info,
+	GenType type,
 	U64 (*get_attacks)(Square target, U64 occupied)
 )
 {
@@ -579,27 +735,28 @@ void generate_sliding_pieces(
 	assert(pos != NULL);
 	assert(move_list != NULL);
 
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 
 	U64 sources = pieces(pos, make_piece(color, pt));
+	U64 targets = gen_targets(pos, type);
 
 	while (sources) {
 		Square source = bit_scan_forward(sources);
 
 		U64 moves = get_attacks(source, pos->state->occupied);
 
-		moves = filter_legal_moves(
+		moves = filter_moves(
 			pos,
+			check_info,
+			type,
 			source,
-			moves,
-			check_ray
+			moves
 		);
 
 		add_common_moves(
 			move_list,
-			make_piece(color, pt),
 			source,
-			moves
+			moves & targets
 		);
 
 		remove_lsb(sources);
@@ -612,52 +769,75 @@ MoveList *generate_all_moves(Position *pos)
 
 	MoveList *move_list = init_move_list();
 
-	Color color = !pos->state->previous_move.color;
+	if (generate_moves(pos, move_list) == NULL) {
+		free(move_list);
 
-	U64 check_ray = UNIVERSE;
+		return NULL;
+	}
 
+	return move_list;
+}
 
-	CheckType check_type = get_check_type(pos);
+/**
+ * \brief Adds the moves of the #GenType to the move list
+ */
+static void generate(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list,
+	GenType type
+)
+{
+	assert(pos != NULL);
+	assert(check_info != NULL);
+	assert(move_list != NULL);
 
-	Square king_sq = bit_scan_forward(
-		pieces(pos, make_piece(color, KING))
-	);
+	Color color = pos->state->turn;
 
-	if (check_type == NO_CHECK) {
-		check_ray = UNIVERSE;
+	Square king_sq = check_info->king_square;
 
-		generate_castlings(pos, move_list);
-	}
+	bool legal = !(type & GEN_PSEUDO_LEGAL);
+	Castling rights = color == WHITE ? ALL_WHITE : ALL_BLACK;
 
-	else if (check_type == SINGLE_CHECK) {
-		U64 king_checker = attacked_by(pos, king_sq, !color);
-		check_ray = ray_between[king_sq][
-			bit_scan_forward(king_checker)
-		] | king_checker;
-	}
+	bool castling = (
+		check_info->checkers == EMPTY && (type & GEN_QUIETS)
+		&& (pos->state->castling & rights)
+	);
 
-	else if (check_type == DOUBLE_CHECK) {
-		check_ray = EMPTY;
-	}
+	// One map of the enemy attacks serves both the king moves and the
+	// castlings. Without the king on the board the squares behind it on a
+	// checking ray are attacked too, which only matters in check, when
+	// castling isn't allowed anyway.
+	U64 attacked = EMPTY;
 
-	else {
-		return NULL;
-	}
+	if (legal || castling)
+		attacked = attacked_squares(
+			pos, !color,
+			pos->state->occupied ^ square_to_bitboard(king_sq)
+		);
+
+	if (castling)
+		generate_castlings_by_attacks(pos, move_list, attacked);
 
-	U64 king_legal_squares = king_safe_moves_mask(pos, king_sq, color);
+	// In pseudo-legal mode is_legal() checks only the destination of the
+	// king move actually searched
+	U64 king_squares = king_attacks[king_sq] & ~(pos->state->allies);
+
+	if (legal)
+		king_squares &= ~attacked;
 
 	add_common_moves(
 		move_list,
-		make_piece(color, KING),
 		king_sq,
-		king_legal_squares
+		king_squares & gen_targets(pos, type)
 	);
 
 	generate_sliding_pieces(
 		move_list,
 		pos,
 		QUEEN,
-		check_ray,
+		check_info,
+		type,
 		queen_attacks_mask
 	);
 
@@ -665,7 +845,8 @@ MoveList *generate_all_moves(Position *pos)
 		move_list,
 		pos,
 		ROOK,
-		check_ray,
+		check_info,
+		type,
 		rook_attacks_mask
 	);
 
@@ -673,21 +854,326 @@ MoveList *generate_all_moves(Position *pos)
 		move_list,
 		pos,
 		BISHOP,
-		check_ray,
+		check_info,
+		type,
 		bishop_attacks_mask
 	);
 
 	generate_knight_moves(
 		move_list,
 		pos,
-		check_ray
+		check_info,
+		type
 	);
 
 	generate_pawn_moves(
 		move_list,
 		pos,
-		check_ray
+		check_info,
+		type
+	);
+}
+
+MoveList *generate_moves(Position *pos, MoveList *move_list)
+{
+	assert(pos != NULL);
+	assert(move_list != NULL);
+
+	ml_clear(move_list);
+
+	CheckInfo check_info;
+
+	init_check_info(pos, &check_info);
+
+	if (population_count(check_info.checkers) > DOUBLE_CHECK)
+		return NULL;
+
+	generate(pos, &check_info, move_list, GEN_ALL);
+
+	return move_list;
+}
+
+uint32_t count_legal_moves(Position *pos)
+{
+	assert(pos != NULL);
+
+	CheckInfo check_info;
+
+	init_check_info(pos, &check_info);
+
+	Color color = pos->state->turn;
+	Square king_sq = check_info.king_square;
+
+	U64 occupied = pos->state->occupied;
+	U64 allies = pos->state->allies;
+
+	U64 attacked = attacked_squares(
+		pos, !color, occupied ^ square_to_bitboard(king_sq)
+	);
+
+	uint32_t count = population_count(
+		king_attacks[king_sq] & ~allies & ~attacked
 	);
 
+	// Only the king may move in double check
+	if (check_info.check_ray == EMPTY)
+		return count;
+
+	// Castlings and en passant are rare, they are simply generated
+	MoveList move_list;
+
+	ml_clear(&move_list);
+
+	Castling rights = color == WHITE ? ALL_WHITE : ALL_BLACK;
+
+	if (check_info.checkers == EMPTY && (pos->state->castling & rights))
+		generate_castlings_by_attacks(pos, &move_list, attacked);
+
+	generate_pawn_en_passant(&move_list, pos, &check_info);
+
+	count += ml_len(&move_list);
+
+	U64 targets = ~allies & check_info.check_ray;
+	U64 pinned = check_info.pinned;
+
+	U64 knights = pieces(pos, make_piece(color, KNIGHT)) & ~pinned;
+
+	while (knights) {
+		count += population_count(
+			knight_attacks[bit_scan_forward(knights)] & targets
+		);
+
+		remove_lsb(knights);
+	}
+
+	U64 queens = pieces(pos, make_piece(color, QUEEN));
+	U64 diagonal = pieces(pos, make_piece(color, BISHOP)) | queens;
+	U64 linear = pieces(pos, make_piece(color, ROOK)) | queens;
+
+	while (diagonal) {
+		Square source = bit_scan_forward(diagonal);
+
+		count += population_count(
+			bishop_attacks_mask(source, occupied) & targets
+			& pin_ray(&check_info, source)
+		);
+
+		remove_lsb(diagonal);
+	}
+
+	while (linear) {
+		Square source = bit_scan_forward(linear);
+
+		count += population_count(
+			rook_attacks_mask(source, occupied) & targets
+			& pin_ray(&check_info, source)
+		);
+
+		remove_lsb(linear);
+	}
+
+	// A pawn move to the last rank is four promotions
+	U64 last_rank = color == WHITE ? RANK_8 : RANK_1;
+
+	U64 pawns = pieces(pos, make_piece(color, PAWN));
+	U64 pinned_pawns = pawns & pinned;
+
+	pawns ^= pinned_pawns;
+
+	while (pinned_pawns) {
+		U64 destinations = pinned_pawn_moves(
+			pos, &check_info, bit_scan_forward(pinned_pawns)
+		);
+
+		count += population_count(destinations & ~last_rank);
+		count += 4 * population_count(destinations & last_rank);
+
+		remove_lsb(pinned_pawns);
+	}
+
+	int32_t up = color == WHITE ? 8 : -8;
+
+	U64 empty = ~occupied;
+	U64 enemies = pos->state->enemies;
+
+	U64 single_pushes = shift_bitboard(pawns, up) & empty;
+	U64 double_pushes = shift_bitboard(
+		single_pushes & (color == WHITE ? RANK_3 : RANK_6), up
+	) & empty;
+
+	U64 west_captures = shift_bitboard(pawns & ~FILE_A, up - 1) & enemies;
+	U64 east_captures = shift_bitboard(pawns & ~FILE_H, up + 1) & enemies;
+
+	U64 pawn_sets[] = {
+		single_pushes, double_pushes, west_captures, east_captures
+	};
+
+	for (size_t i = 0; i < sizeof(pawn_sets) / sizeof(*pawn_sets); i++) {
+		U64 destinations = pawn_sets[i] & check_info.check_ray;
+
+		count += population_count(destinations & ~last_rank);
+		count += 4 * population_count(destinations & last_rank);
+	}
+
+	return count;
+}
+
+MoveList *generate_captures(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list
+)
+{
+	generate(pos, check_info, move_list, GEN_CAPTURES);
+
+	return move_list;
+}
+
+MoveList *generate_quiets(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list
+)
+{
+	generate(pos, check_info, move_list, GEN_QUIETS);
+
 	return move_list;
 }
+
+MoveList *generate_pseudo_legal(
+	Position *pos,
+	const CheckInfo *check_info,
+	MoveList *move_list,
+	GenType type
+)
+{
+	generate(pos, check_info, move_list, type | GEN_PSEUDO_LEGAL);
+
+	return move_list;
+}
+
+bool is_legal(const Position *pos, const CheckInfo *check_info, Move move)
+{
+	assert(pos != NULL);
+	assert(check_info != NULL);
+
+	Square source = source_of_move(move);
+	Square destination = destination_of_move(move);
+
+	// Castlings and en passant are generated legal
+	if (type_of_move(move) == CASTLING || type_of_move(move) == EN_PASSANT)
+		return true;
+
+	if (source != check_info->king_square)
+		return (
+			pin_ray(check_info, source)
+			& square_to_bitboard(destination)
+		) != EMPTY;
+
+	Color color = pos->state->turn;
+
+	// The king doesn't block the sliders checking it along the ray
+	U64 occupied = pos->state->occupied ^ square_to_bitboard(source);
+
+	U64 linear = (
+		pieces(pos, make_piece(!color, ROOK))
+		| pieces(pos, make_piece(!color, QUEEN))
+	);
+
+	U64 diagonal = (
+		pieces(pos, make_piece(!color, BISHOP))
+		| pieces(pos, make_piece(!color, QUEEN))
+	);
+
+	return !(
+		(pawn_attacks[color][destination]
+			& pieces(pos, make_piece(!color, PAWN)))
+		| (knight_attacks[destination]
+			& pieces(pos, make_piece(!color, KNIGHT)))
+		| (king_attacks[destination]
+			& pieces(pos, make_piece(!color, KING)))
+		| (bishop_attacks_mask(destination, occupied) & diagonal)
+		| (rook_attacks_mask(destination, occupied) & linear)
+	);
+}
+
+bool is_valid_move(Position *pos, const CheckInfo *check_info, Move move)
+{
+	assert(pos != NULL);
+	assert(check_info != NULL);
+
+	if (move == MOVE_NONE || move == MOVE_NULL)
+		return false;
+
+	Color color = pos->state->turn;
+
+	Square source = source_of_move(move);
+	Piece piece = piece_on(pos, source);
+
+	if (piece == NO_PIECE || color_of_piece(piece) != color)
+		return false;
+
+	MoveList move_list;
+
+	ml_clear(&move_list);
+
+	U64 source_bitboard = square_to_bitboard(source);
+
+	switch (type_of_piece(piece)) {
+		case PAWN:
+			if (source_bitboard & (color ? RANK_2 : RANK_7))
+				generate_pawn_promotions(
+					&move_list, pos, check_info, GEN_ALL,
+					source_bitboard
+				);
+			else if (type_of_move(move) == EN_PASSANT)
+				generate_pawn_en_passant(
+					&move_list, pos, check_info
+				);
+			else
+				generate_pawn_common(
+					&move_list, pos, check_info, GEN_ALL,
+					source_bitboard
+				);
+			break;
+		case KNIGHT:
+			generate_knight_moves(
+				&move_list, pos, check_info, GEN_ALL
+			);
+			break;
+		case BISHOP:
+			generate_sliding_pieces(
+				&move_list, pos, BISHOP, check_info, GEN_ALL,
+				bishop_attacks_mask
+			);
+			break;
+		case ROOK:
+			generate_sliding_pieces(
+				&move_list, pos, ROOK, check_info, GEN_ALL,
+				rook_attacks_mask
+			);
+			break;
+		case QUEEN:
+			generate_sliding_pieces(
+				&move_list, pos, QUEEN, check_info, GEN_ALL,
+				queen_attacks_mask
+			);
+			break;
+		default:
+			add_common_moves(
+				&move_list,
+				source,
+				king_safe_moves_mask(pos, source, color)
+			);
+
+			if (check_info->checkers == EMPTY)
+				generate_castlings(pos, &move_list);
+	}
+
+	for (ExtMove *ext = move_list.move_list; ext < move_list.last; ext++) {
+		if (ext->move == move)
+			return true;
+	}
+
+	return false;
+}
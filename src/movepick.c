@@ -0,0 +1,291 @@
+#include "bitboard.h"
+#include "position.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "search.h"
+
+#include <assert.h>
+#include <stddef.h>
+
+/**
+ * \brief Returns true if the move is produced by generate_captures()
+ *
+ * \param pos current position
+ *
+ * \param move legal move
+ */
+static inline bool is_capture_stage_move(const Position *pos, Move move)
+{
+	return (
+		piece_on(pos, destination_of_move(move)) != NO_PIECE
+		|| type_of_move(move) == EN_PASSANT
+		|| promotion_of_move(move) == QUEEN
+	);
+}
+
+/**
+ * \brief Returns true if the capture loses material by static exchange
+ * evaluation. Such captures are searched after the quiet moves.
+ *
+ * \param pos current position
+ *
+ * \param move capture
+ */
+static bool is_bad_capture(const Position *pos, Move move)
+{
+	if (type_of_move(move) != COMMON)
+		return false;
+
+	PieceType attacker = type_of_piece(
+		piece_on(pos, source_of_move(move))
+	);
+	PieceType victim = type_of_piece(
+		piece_on(pos, destination_of_move(move))
+	);
+
+	// Taking a piece of the same value or more never loses material
+	if (
+		attacker == KING
+		|| piece_type_value[MIDDLEGAME][attacker - 1]
+		<= piece_type_value[MIDDLEGAME][victim - 1]
+	)
+		return false;
+
+	return static_exchange(pos, move) < 0;
+}
+
+/**
+ * \brief Scores captures by #mvv_lva, a promotion without capture scores as
+ * a capture of a queen
+ */
+static void score_captures(MovePicker *picker)
+{
+	const Position *pos = picker->pos;
+
+	for (
+		ExtMove *ext = picker->current;
+		ext < picker->move_list->last;
+		ext++
+	) {
+		Move move = ext->move;
+
+		PieceType attacker = type_of_piece(
+			piece_on(pos, source_of_move(move))
+		);
+		PieceType victim = type_of_piece(
+			piece_on(pos, destination_of_move(move))
+		);
+
+		if (type_of_move(move) == EN_PASSANT)
+			victim = PAWN;
+		else if (victim == NO_PIECE_TYPE)
+			victim = QUEEN;
+
+		ext->eval = mvv_lva[attacker - 1][victim - 1];
+	}
+}
+
+/**
+ * \brief Scores quiet moves by the history heuristic
+ */
+static void score_quiets(MovePicker *picker)
+{
+	const Position *pos = picker->pos;
+
+	for (
+		ExtMove *ext = picker->current;
+		ext < picker->move_list->last;
+		ext++
+	) {
+		Piece piece = piece_on(pos, source_of_move(ext->move));
+
+		ext->eval = picker->history[history_index(piece)][
+			destination_of_move(ext->move)
+		];
+	}
+}
+
+/**
+ * \brief Moves the best scored move of [begin, end) to begin. Only the moves
+ * actually searched are ever sorted.
+ *
+ * \return begin
+ */
+static ExtMove *pick_best(ExtMove *begin, ExtMove *end)
+{
+	ExtMove *best = begin;
+
+	for (ExtMove *ext = begin + 1; ext < end; ext++) {
+		if (ext->eval > best->eval)
+			best = ext;
+	}
+
+	ExtMove tmp = *best;
+
+	for (; best > begin; best--)
+		*best = *(best - 1);
+
+	*begin = tmp;
+
+	return begin;
+}
+
+void init_move_picker(
+	MovePicker *picker,
+	Position *pos,
+	MoveList *move_list,
+	Move hash_move,
+	Move killer_1,
+	Move killer_2,
+	Evaluation history[12][64]
+)
+{
+	assert(picker != NULL);
+	assert(pos != NULL);
+	assert(move_list != NULL);
+	assert(history != NULL);
+
+	picker->pos = pos;
+	picker->move_list = move_list;
+
+	init_check_info(pos, &picker->check_info);
+
+	ml_clear(move_list);
+
+	picker->current = move_list->move_list;
+	picker->bad_captures_end = move_list->move_list;
+
+	picker->hash_move = (
+		is_valid_move(pos, &picker->check_info, hash_move)
+		? hash_move : MOVE_NONE
+	);
+
+	picker->killers[0] = killer_1;
+	picker->killers[1] = killer_2 != killer_1 ? killer_2 : MOVE_NONE;
+	picker->killer_index = 0;
+
+	picker->history = history;
+
+	picker->stage = STAGE_HASH_MOVE;
+}
+
+Move next_move(MovePicker *picker)
+{
+	assert(picker != NULL);
+
+	MoveList *move_list = picker->move_list;
+
+	switch (picker->stage) {
+		case STAGE_HASH_MOVE:
+			picker->stage++;
+
+			if (picker->hash_move != MOVE_NONE)
+				return picker->hash_move;
+
+			/* fall through */
+		case STAGE_GENERATE_CAPTURES:
+			generate_pseudo_legal(
+				picker->pos, &picker->check_info, move_list,
+				GEN_CAPTURES
+			);
+			score_captures(picker);
+
+			picker->stage++;
+
+			/* fall through */
+		case STAGE_GOOD_CAPTURES:
+			while (picker->current < move_list->last) {
+				ExtMove *ext = pick_best(
+					picker->current++, move_list->last
+				);
+
+				if (ext->move == picker->hash_move)
+					continue;
+
+				// The slot is already consumed, so it can
+				// hold the bad capture until the last stage
+				if (is_bad_capture(picker->pos, ext->move)) {
+					*picker->bad_captures_end++ = *ext;
+
+					continue;
+				}
+
+				return ext->move;
+			}
+
+			picker->stage++;
+
+			/* fall through */
+		case STAGE_KILLERS:
+			while (picker->killer_index < 2) {
+				Move *killer = &picker->killers[
+					picker->killer_index++
+				];
+
+				if (
+					*killer == picker->hash_move
+					|| !is_valid_move(
+						picker->pos,
+						&picker->check_info,
+						*killer
+					)
+					|| is_capture_stage_move(
+						picker->pos, *killer
+					)
+				) {
+					*killer = MOVE_NONE;
+
+					continue;
+				}
+
+				return *killer;
+			}
+
+			picker->stage++;
+
+			/* fall through */
+		case STAGE_GENERATE_QUIETS:
+			move_list->last = picker->bad_captures_end;
+			picker->current = picker->bad_captures_end;
+
+			generate_pseudo_legal(
+				picker->pos, &picker->check_info, move_list,
+				GEN_QUIETS
+			);
+			score_quiets(picker);
+
+			picker->stage++;
+
+			/* fall through */
+		case STAGE_QUIETS:
+			while (picker->current < move_list->last) {
+				ExtMove *ext = pick_best(
+					picker->current++, move_list->last
+				);
+
+				if (
+					ext->move == picker->hash_move
+					|| ext->move == picker->killers[0]
+					|| ext->move == picker->killers[1]
+				)
+					continue;
+
+				return ext->move;
+			}
+
+			picker->current = move_list->move_list;
+			picker->stage++;
+
+			/* fall through */
+		case STAGE_BAD_CAPTURES:
+			if (picker->current < picker->bad_captures_end)
+				return (picker->current++)->move;
+
+			picker->stage++;
+
+			/* fall through */
+		default:
+			return MOVE_NONE;
+	}
+}
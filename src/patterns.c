@@ -5,6 +5,21 @@
 
 #include <assert.h>
 
+U64 knight_attacks[SQ_NB];
+U64 king_attacks[SQ_NB];
+U64 pawn_attacks[COLOR_NB][SQ_NB];
+
+void init_patterns(void)
+{
+	for(Square sq = SQ_A1; sq < SQ_NB; sq++) {
+		knight_attacks[sq] = knight_move_pattern(sq);
+		king_attacks[sq] = king_move_pattern(sq);
+
+		pawn_attacks[WHITE][sq] = white_pawn_attack_pattern(sq);
+		pawn_attacks[BLACK][sq] = black_pawn_attack_pattern(sq);
+	}
+}
+
 U64 white_pawn_move_pattern(Square target)
 {
 	assert(target < SQ_NB);
@@ -11,6 +11,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
 
 #define BYTE_TO_BINARY_PATTERN "%c%c%c%c%c%c%c%c"
 #define BYTE_TO_BINARY(byte)		\
@@ -24,6 +28,9 @@
 	(byte & 0x80 ? '1' : '0')
 
 
+/// Preallocated move lists, indexed by the remaining depth
+static MoveList perft_stack[MAX_PLY];
+
 void print_bitboard(U64 *bitboard)
 {
 	for(uint8_t counter = 0; counter != 8; counter++) {
@@ -36,34 +43,177 @@ void print_bitboard(U64 *bitboard)
 	}
 }
 
-U64 perft(Position *pos, int depth)
+/// Perft hash table entry. The data holds the depth in the low 8 bits and the
+/// node count above them. The key is stored xor-ed with the data, so an entry
+/// torn by two threads writing at the same time fails the key check and no
+/// lock is needed.
+typedef struct PerftEntry {
+	_Atomic U64 key_xor_data;	///< Zobrist key xor data
+	_Atomic U64 data;		///< Depth and node count
+} PerftEntry;
+
+/// Perft hash table, shared by all the perft threads
+static struct {
+	PerftEntry *entries;	///< Entries, NULL when the table is disabled
+	U64 entry_count;	///< Number of entries, always a power of two
+} perft_table = {.entries = NULL, .entry_count = 0};
+
+bool perft_table_resize(size_t megabytes)
+{
+	perft_table_free();
+
+	if (megabytes == 0)
+		return true;
+
+	U64 entry_count = 1;
+
+	while (entry_count * 2 * sizeof(PerftEntry) <= megabytes << 20)
+		entry_count *= 2;
+
+	perft_table.entries = calloc(entry_count, sizeof(PerftEntry));
+
+	if (perft_table.entries == NULL)
+		return false;
+
+	perft_table.entry_count = entry_count;
+
+	return true;
+}
+
+void perft_table_free(void)
+{
+	free(perft_table.entries);
+
+	perft_table.entries = NULL;
+	perft_table.entry_count = 0;
+}
+
+void perft_table_clear(void)
+{
+	if (perft_table.entries != NULL)
+		memset(
+			perft_table.entries, 0,
+			perft_table.entry_count * sizeof(PerftEntry)
+		);
+}
+
+/**
+ * \brief Looks for the node count of the subtree in the perft hash table
+ *
+ * \return true and sets nodes if the position is stored for the depth
+ */
+static inline bool perft_table_probe(U64 key, int depth, U64 *nodes)
+{
+	PerftEntry *entry = &perft_table.entries[
+		key & (perft_table.entry_count - 1)
+	];
+
+	U64 data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+	U64 check = atomic_load_explicit(
+		&entry->key_xor_data, memory_order_relaxed
+	);
+
+	if ((check ^ data) != key || (data & 0xFF) != (U64)depth)
+		return false;
+
+	*nodes = data >> 8;
+
+	return true;
+}
+
+/**
+ * \brief Stores the node count of the subtree, the old entry is replaced
+ */
+static inline void perft_table_store(U64 key, int depth, U64 nodes)
+{
+	PerftEntry *entry = &perft_table.entries[
+		key & (perft_table.entry_count - 1)
+	];
+
+	U64 data = (nodes << 8) | (U64)depth;
+
+	atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+	atomic_store_explicit(
+		&entry->key_xor_data, key ^ data, memory_order_relaxed
+	);
+}
+
+/**
+ * \brief Perft with the move lists taken from the given stack, indexed by the
+ * remaining depth, so every thread can have its own
+ */
+static U64 perft_with_stack(Position *pos, int depth, MoveList *stack)
 {
 	if (depth == 0) {
 		return 1ULL;
 	}
 
+	// Bulk counting, the leaves are never made
+	if (depth == 1)
+		return count_legal_moves(pos);
+
+	assert(depth < MAX_PLY);
+
 	U64 nodes = 0;
-	MoveList *move_list = generate_all_moves(pos);
+	U64 key = pos->state->key;
+
+	bool use_table = perft_table.entries != NULL;
+
+	if (use_table && perft_table_probe(key, depth, &nodes))
+		return nodes;
+
+	MoveList *move_list = generate_moves(pos, &stack[depth]);
 
 	for (int i = 0; i < ml_len(move_list); i++) {
 		do_move(pos, move_list->move_list[i].move);
-		nodes += perft(pos, depth - 1);
+		nodes += perft_with_stack(pos, depth - 1, stack);
 		undo_move(pos);
 	}
 
-	free(move_list);
+	if (use_table)
+		perft_table_store(key, depth, nodes);
 
 	return nodes;
 }
 
+U64 perft(Position *pos, int depth)
+{
+	return perft_with_stack(pos, depth, perft_stack);
+}
+
+/**
+ * \brief Prints the number of nodes under the root move
+ */
+static void print_divide(Move move, U64 nodes)
+{
+	Square source = source_of_move(move);
+	Square destination = destination_of_move(move);
+
+	char source_rank = '1' + source / 8;
+	char destination_rank = '1' + destination / 8;
+
+	char source_file = 'a' + source - source / 8 * 8;
+	char destination_file = 'a' + destination - destination / 8 * 8;
+
+	printf("    move: %c%c", source_file, source_rank);
+	printf(
+		"%c%c    nodes: %lu\n",
+		destination_file,
+		destination_rank,
+		nodes
+	);
+}
+
 U64 perft_test(Position *pos, int depth)
 {
 	if (depth == 0) {
 		return 1ULL;
 	}
 
+	assert(depth < MAX_PLY);
+
 	U64 nodes = 0;
-	MoveList *move_list = generate_all_moves(pos);
+	MoveList *move_list = generate_moves(pos, &perft_stack[depth]);
 
 	for (int i = 0; i < ml_len(move_list); i++) {
 
@@ -73,31 +223,176 @@ U64 perft_test(Position *pos, int depth)
 		nodes += perft(pos, depth - 1);
 		undo_move(pos);
 
-		U64 old_nodes = nodes - cummulative_nodes;
+		print_divide(
+			move_list->move_list[i].move, nodes - cummulative_nodes
+		);
+	}
+
+	printf("Nodes searched: %li\n\n", nodes);
+
+	return nodes;
+}
+
+/// Subtree of the parallel perft: a root move and a reply to it
+typedef struct PerftTask {
+	Move moves[2];		///< Root move and the reply
+	uint32_t root_index;	///< Index of the root move in the root list
+	U64 nodes;		///< Nodes of the subtree, set by the worker
+} PerftTask;
+
+/// Work queue shared by the perft workers
+typedef struct PerftQueue {
+	const Position *root;	///< Root position, every worker copies it
+	int depth;		///< Depth left after the two moves of a task
+
+	PerftTask *tasks;	///< All the subtrees
+	size_t tasks_nb;	///< Number of the subtrees
+	atomic_size_t next;	///< Next task to take
+} PerftQueue;
+
+/**
+ * \brief Takes tasks from the queue until it is empty. Each worker owns a copy
+ * of the root position and its own move list stack.
+ */
+static void *perft_worker(void *arg)
+{
+	PerftQueue *queue = arg;
+
+	Position *pos = copy_position(queue->root);
+	MoveList *stack = malloc(MAX_PLY * sizeof(MoveList));
+
+	// The other workers take the tasks, perft_parallel() notices if none
+	// could
+	if (pos == NULL || stack == NULL) {
+		free(stack);
+		free_position(pos);
+
+		return NULL;
+	}
+
+	size_t i;
+
+	while ((i = atomic_fetch_add(&queue->next, 1)) < queue->tasks_nb) {
+		PerftTask *task = &queue->tasks[i];
+
+		do_move(pos, task->moves[0]);
+		do_move(pos, task->moves[1]);
+
+		task->nodes = perft_with_stack(pos, queue->depth, stack);
+
+		undo_move(pos);
+		undo_move(pos);
+	}
+
+	free(stack);
+	free_position(pos);
+
+	return NULL;
+}
+
+U64 perft_parallel(Position *pos, int depth, uint32_t threads_nb)
+{
+	assert(pos != NULL);
+	assert(threads_nb > 0);
 
-		// Print move
+	if (depth < 3 || threads_nb == 1)
+		return perft_test(pos, depth);
 
-		Square source = move_list->move_list[i].move.source;
-		Square destination = move_list->move_list[i].move.destination;
+	assert(depth < MAX_PLY);
 
-		char source_rank = '1' + source / 8;
-		char destination_rank = '1' + destination / 8;
+	MoveList *root_moves = generate_moves(pos, &perft_stack[depth]);
+	size_t root_nb = ml_len(root_moves);
 
-		char source_file = 'a' + source - source / 8 * 8;
-		char destination_file = 'a' + destination - destination / 8 * 8;
+	// Checkmate or stalemate, there is nothing to distribute
+	if (root_nb == 0)
+		return perft_test(pos, depth);
 
-		printf("    move: %c%c", source_file, source_rank);
-		printf(
-			"%c%c    nodes: %lu\n",
-			destination_file,
-			destination_rank,
-			old_nodes
+	// Root moves alone are too few to keep many threads busy, so the
+	// subtrees two plies deep are distributed
+	PerftTask *tasks = malloc(root_nb * MOVE_MAX * sizeof(PerftTask));
+	U64 *root_nodes = calloc(root_nb, sizeof(U64));
+	pthread_t *threads = malloc(threads_nb * sizeof(pthread_t));
+
+	// Without the memory for the queue one thread walks the whole tree
+	if (tasks == NULL || root_nodes == NULL || threads == NULL) {
+		free(threads);
+		free(root_nodes);
+		free(tasks);
+
+		return perft_test(pos, depth);
+	}
+
+	size_t tasks_nb = 0;
+
+	for (size_t i = 0; i < root_nb; i++) {
+		Move move = root_moves->move_list[i].move;
+
+		do_move(pos, move);
+
+		MoveList *replies = generate_moves(
+			pos, &perft_stack[depth - 1]
 		);
+
+		for (ExtMove *ext = replies->move_list; ext < replies->last; ext++) {
+			tasks[tasks_nb++] = (PerftTask) {
+				.moves = {move, ext->move},
+				.root_index = i,
+				.nodes = 0,
+			};
+		}
+
+		undo_move(pos);
+	}
+
+	PerftQueue queue = {
+		.root = pos,
+		.depth = depth - 2,
+		.tasks = tasks,
+		.tasks_nb = tasks_nb,
+	};
+
+	atomic_init(&queue.next, 0);
+
+	uint32_t started = 0;
+
+	for (uint32_t i = 0; i < threads_nb; i++) {
+		int error = pthread_create(
+			&threads[started], NULL, perft_worker, &queue
+		);
+
+		if (error == 0)
+			started++;
+	}
+
+	for (uint32_t i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	// Every worker failed to start or to allocate its position, so some
+	// subtrees weren't walked
+	if (atomic_load(&queue.next) < tasks_nb) {
+		free(threads);
+		free(root_nodes);
+		free(tasks);
+
+		return perft_test(pos, depth);
+	}
+
+	for (size_t i = 0; i < tasks_nb; i++)
+		root_nodes[tasks[i].root_index] += tasks[i].nodes;
+
+	U64 nodes = 0;
+
+	for (size_t i = 0; i < root_nb; i++) {
+		print_divide(root_moves->move_list[i].move, root_nodes[i]);
+
+		nodes += root_nodes[i];
 	}
 
 	printf("Nodes searched: %li\n\n", nodes);
 
-	free(move_list);
+	free(threads);
+	free(root_nodes);
+	free(tasks);
 
 	return nodes;
 }
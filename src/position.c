@@ -4,6 +4,8 @@
 #include "patterns.h"
 #include "masks.h"
 #include "position.h"
+#include "hash.h"
+#include "movegen.h"
 
 #include <stdio.h>
 #include <ctype.h>
@@ -131,14 +133,8 @@ static bool init_turn(Position *position, char *turn)
 	if(strlen(turn) != 1 || (*turn != 'b' && *turn != 'w'))
 		return false;
 
-	position->state->previous_move = (Move) {
-		.color = !(*turn == 'b'),
-		.move_type = COMMON,
-		.source = SQ_NONE,
-		.destination = SQ_NONE,
-		.moved_piece_type = NO_PIECE_TYPE,
-		.promotion_piece_type = NO_PIECE_TYPE,
-	};
+	position->state->previous_move = MOVE_NONE;
+	position->state->turn = *turn == 'b';
 
 	return true;
 }
@@ -203,6 +199,8 @@ static bool init_en_passant(Position *pos, char *en_passant)
 	if(pos == NULL || en_passant == NULL)
 		return false;
 
+	pos->state->en_passant = SQ_NONE;
+
 	if(en_passant[0] != '-') {
 		if(strlen(en_passant) != 2)
 			return false;
@@ -210,19 +208,9 @@ static bool init_en_passant(Position *pos, char *en_passant)
 		if(!isdigit(en_passant[1]) || !islower(en_passant[0]))
 			return false;
 
-		Square target = (
+		pos->state->en_passant = (
 			(en_passant[1] - '1') * 8 + en_passant[0] - 'a'
 		);
-
-		Color color = pos->state->previous_move.color;
-
-		pos->state->previous_move = (Move) {
-			.destination = target - 8 + (16 * !color),
-			.source = target + 8 - (16 * !color),
-			.color = color,
-			.move_type = EN_PASSANT,
-			.moved_piece_type = PAWN,
-		};
 	}
 
 	return true;
@@ -281,9 +269,14 @@ Position* init_position(const char *fen)
 	char *turn = strtok(NULL, " ");
 	char *castlings = strtok(NULL, " ");
 	char *en_passant = strtok(NULL, " ");
+	char *move_50_rule = strtok(NULL, " ");
 
 	Position *position = calloc(1, sizeof(Position));
-	position->state = calloc(1, sizeof(PositionState));
+
+	if(position == NULL)
+		return NULL;
+
+	position->state = position->state_history;
 
 	PositionState *state = position->state;
 
@@ -298,30 +291,117 @@ Position* init_position(const char *fen)
 	)
 		goto err;
 
-	color = !state->previous_move.color;
+	color = state->turn;
 
 	state->captured_piece = NO_PIECE;
-	state->move_50_rule = 0;
-
-	state->allies = EMPTY;
-	state->enemies = EMPTY;
-
-	for(PieceType pt = PAWN; pt <= PIECE_TYPE_NB; pt++) {
-		state->allies |= pieces(position, make_piece(color, pt));
-		state->enemies |= pieces(position, make_piece(!color, pt));
-	}
+	state->move_50_rule = move_50_rule ? atoi(move_50_rule) : 0;
 
+	state->allies = position->occupied_by[color];
+	state->enemies = position->occupied_by[!color];
 	state->occupied = state->allies | state->enemies;
 
+	state->key = generate_hash_key(position);
+
 	return position;
 
 err:
-	free(position->state);
-	free(position);
+	free_position(position);
 
 	return NULL;
 }
 
+void free_position(Position *pos)
+{
+	free(pos);
+}
+
+bool is_repetition(const Position *pos)
+{
+	assert(pos != NULL);
+
+	const PositionState *state = pos->state;
+
+	// The states before the start position are unknown, even if the FEN
+	// says the last irreversible move was earlier
+	uint32_t plies = state->move_50_rule;
+
+	if (plies > (uint32_t)(state - pos->state_history))
+		plies = state - pos->state_history;
+
+	// Only the positions with the same side to move are compared
+	for (uint32_t i = 2; i <= plies; i += 2) {
+		if (
+			(state - i + 2)->previous_move == MOVE_NULL
+			|| (state - i + 1)->previous_move == MOVE_NULL
+		)
+			return false;
+
+		if ((state - i)->key == state->key)
+			return true;
+	}
+
+	return false;
+}
+
+bool is_draw(Position *pos)
+{
+	assert(pos != NULL);
+
+	if (is_repetition(pos))
+		return true;
+
+	if (pos->state->move_50_rule < MOVE_50_RULE_LIMIT)
+		return false;
+
+	// A checkmate on the last ply of the 50 move rule still wins the game
+	return (
+		get_check_type(pos) == NO_CHECK
+		|| count_legal_moves(pos) > 0
+	);
+}
+
+Position *copy_position(const Position *pos)
+{
+	assert(pos != NULL);
+
+	Position *copy = malloc(sizeof(Position));
+
+	if (copy == NULL)
+		return NULL;
+
+	memcpy(copy, pos, sizeof(Position));
+
+	// The state points into the copied history, not into the original one
+	copy->state = copy->state_history + (pos->state - pos->state_history);
+
+	return copy;
+}
+
+/**
+ * \brief Pushes a new state on top of the state history and returns it.
+ * The new state isn't initialized.
+ *
+ * \param pos position
+ */
+static inline PositionState *push_state(Position *pos)
+{
+	assert(pos->state + 1 < pos->state_history + STATE_HISTORY_NB);
+
+	return ++pos->state;
+}
+
+/**
+ * \brief Pops the current state from the state history.
+ *
+ * \param pos position
+ */
+static inline void pop_state(Position *pos)
+{
+	assert(pos->state > pos->state_history);
+
+	--pos->state;
+}
+
 U64 pieces(const Position *pos, Piece piece)
 {
 	assert(pos != NULL);
@@ -343,6 +423,9 @@ void set_piece(Position *pos, Piece piece, Square target)
 	pos->board.pieces[
 		(color * 6) + piece_type - 1
 	] |= square_to_bitboard(target);
+
+	pos->occupied_by[color] |= square_to_bitboard(target);
+	pos->board_squares[target] = piece;
 }
 
 void remove_piece(Position *pos, Piece piece, Square target)
@@ -351,9 +434,14 @@ void remove_piece(Position *pos, Piece piece, Square target)
 	assert(piece != NO_PIECE);
 	assert(target < SQ_NB);
 
+	const Color color = color_of_piece(piece);
+
 	pos->board.pieces[
-		((color_of_piece(piece)) * 6) + type_of_piece(piece) - 1
+		(color * 6) + type_of_piece(piece) - 1
 	] &= ~(square_to_bitboard(target));
+
+	pos->occupied_by[color] &= ~(square_to_bitboard(target));
+	pos->board_squares[target] = NO_PIECE;
 }
 
 void move_piece(Position *pos, Piece piece, Square source, Square destination)
@@ -372,23 +460,7 @@ Piece piece_on(const Position *pos, Square target)
 	assert(pos != NULL);
 	assert(target < SQ_NB);
 
-	const U64 bb = square_to_bitboard(target);
-
-	return (
-		!!(bb & ~pos->state->occupied)		* NO_PIECE
-		| !!(pieces(pos, W_PAWN  ) & bb)	* W_PAWN
-		| !!(pieces(pos, W_KNIGHT) & bb)	* W_KNIGHT
-		| !!(pieces(pos, W_BISHOP) & bb)	* W_BISHOP
-		| !!(pieces(pos, W_ROOK  ) & bb)	* W_ROOK
-		| !!(pieces(pos, W_QUEEN ) & bb)	* W_QUEEN
-		| !!(pieces(pos, W_KING  ) & bb)	* W_KING
-		| !!(pieces(pos, B_PAWN  ) & bb)	* B_PAWN
-		| !!(pieces(pos, B_KNIGHT) & bb)	* B_KNIGHT
-		| !!(pieces(pos, B_BISHOP) & bb)	* B_BISHOP
-		| !!(pieces(pos, B_ROOK  ) & bb)	* B_ROOK
-		| !!(pieces(pos, B_QUEEN ) & bb)	* B_QUEEN
-		| !!(pieces(pos, B_KING  ) & bb)	* B_KING
-	);
+	return pos->board_squares[target];
 }
 
 U64 attacked_by(const Position *pos, Square target, Color attackers_color)
@@ -412,19 +484,76 @@ U64 attacked_by(const Position *pos, Square target, Color attackers_color)
 	) | queens;
 
 	return (
-		(pawn_attack_pattern[!attackers_color](target)	& pawns)
-		| (knight_move_pattern(target)			& knights)
+		(pawn_attacks[!attackers_color][target]	& pawns)
+		| (knight_attacks[target]			& knights)
 		| (bishop_attacks_mask(target, occupied)	& bishops)
 		| (rook_attacks_mask(target, occupied)		& rooks)
-		| (king_move_pattern(target)			& king)
+		| (king_attacks[target]				& king)
+	);
+}
+
+U64 attacked_squares(
+	const Position *pos,
+	Color attackers_color,
+	U64 occupied
+)
+{
+	assert(pos != NULL);
+	assert(attackers_color < COLOR_NB);
+
+	const U64 pawns = pieces(pos, make_piece(attackers_color, PAWN));
+	const U64 knights = pieces(pos, make_piece(attackers_color, KNIGHT));
+	const U64 king = pieces(pos, make_piece(attackers_color, KING));
+
+	const U64 queens = pieces(pos, make_piece(attackers_color, QUEEN));
+	U64 rooks = pieces(pos, make_piece(attackers_color, ROOK)) | queens;
+	U64 bishops = pieces(pos, make_piece(attackers_color, BISHOP)) | queens;
+
+	U64 attacks = (
+		attackers_color == WHITE
+		? ((pawns & ~FILE_A) << 7) | ((pawns & ~FILE_H) << 9)
+		: ((pawns & ~FILE_A) >> 9) | ((pawns & ~FILE_H) >> 7)
+	);
+
+	// Knight jumps are one file and two ranks or two files and one rank
+	U64 one_file = (
+		((knights & ~FILE_A) >> 1) | ((knights & ~FILE_H) << 1)
+	);
+	U64 two_files = (
+		((knights & ~(FILE_A | FILE_B)) >> 2)
+		| ((knights & ~(FILE_G | FILE_H)) << 2)
 	);
+
+	attacks |= (
+		(one_file << 16) | (one_file >> 16)
+		| (two_files << 8) | (two_files >> 8)
+	);
+
+	if (king)
+		attacks |= king_attacks[bit_scan_forward(king)];
+
+	while (rooks) {
+		attacks |= rook_attacks_mask(bit_scan_forward(rooks), occupied);
+
+		remove_lsb(rooks);
+	}
+
+	while (bishops) {
+		attacks |= bishop_attacks_mask(
+			bit_scan_forward(bishops), occupied
+		);
+
+		remove_lsb(bishops);
+	}
+
+	return attacks;
 }
 
 CheckType get_check_type(const Position *pos)
 {
 	assert(pos != NULL);
 
-	Color color = pos->state->previous_move.color;
+	Color color = !pos->state->turn;
 
 	U64 attackers = attacked_by(
 		pos,
@@ -466,144 +595,148 @@ void do_castling(Position *pos, Castling castling)
 
 	move_piece(pos, make_piece(color, KING), king_src, king_dst);
 	move_piece(pos, make_piece(color, ROOK), rook_src, rook_dst);
+
+	pos->state->key ^= (
+		piece_key(make_piece(color, KING), king_src)
+		^ piece_key(make_piece(color, KING), king_dst)
+		^ piece_key(make_piece(color, ROOK), rook_src)
+		^ piece_key(make_piece(color, ROOK), rook_dst)
+	);
 }
 
 void do_null_move(Position *pos)
 {
 	assert(pos != NULL);
 
-	PositionState *state = malloc(sizeof(PositionState));
-
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 
-	Move null_move = {
-		.move_type = COMMON, .moved_piece_type = NO_PIECE_TYPE,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = color,
-		.source = SQ_NB, .destination = SQ_NB
-	};
+	PositionState *state = push_state(pos);
+	PositionState *previous_state = state - 1;
 
-	state->move_50_rule = pos->state->move_50_rule;
+	state->move_50_rule = previous_state->move_50_rule;
 	state->captured_piece = NO_PIECE;
-	state->castling = pos->state->castling;
-	state->previous_state = pos->state;
-	state->previous_move = null_move;
-
-	pos->state = state;
-
-	state->allies = EMPTY;
-	state->enemies = EMPTY;
-
-	for(PieceType pt = PAWN; pt <= PIECE_TYPE_NB; pt++) {
-		state->allies |= pieces(pos, make_piece(!color, pt));
-		state->enemies |= pieces(pos, make_piece(color, pt));
-	}
+	state->castling = previous_state->castling;
+	state->previous_move = MOVE_NULL;
+	state->turn = !color;
+	state->en_passant = SQ_NONE;
+
+	state->allies = previous_state->enemies;
+	state->enemies = previous_state->allies;
+	state->occupied = previous_state->occupied;
+
+	state->key = (
+		previous_state->key ^ side_key
+		^ en_passant_key(previous_state->en_passant)
+	);
 
-	state->occupied = state->allies | state->enemies;
+	assert(state->key == generate_hash_key(pos));
 }
 
 void undo_null_move(Position *pos)
 {
 	assert(pos != NULL);
 
-	PositionState *temp = pos->state;
-	pos->state = pos->state->previous_state;
-	free(temp);
+	pop_state(pos);
 }
 
 void do_move(Position *pos, Move move)
 {
 	assert(pos != NULL);
-	assert(move.destination != SQ_NONE && move.source != SQ_NONE);
-	assert(move.moved_piece_type != NO_PIECE_TYPE);
-	assert(pos->state->move_50_rule != 50);
+	assert(move != MOVE_NONE && move != MOVE_NULL);
+
+	Color color = pos->state->turn;
+
+	Square source = source_of_move(move);
+	Square destination = destination_of_move(move);
+	MoveType move_type = type_of_move(move);
+
+	Piece piece = pos->board_squares[source];
+	Piece captured_piece = (
+		move_type == EN_PASSANT
+		? (Piece)make_piece(!color, PAWN)
+		: pos->board_squares[destination]
+	);
 
-	PositionState *state = malloc(sizeof(PositionState));
+	assert(piece != NO_PIECE && color_of_piece(piece) == color);
 
-	assert(state != NULL);
+	PositionState *previous_state = pos->state;
+	PositionState *state = push_state(pos);
 
-	Color color = move.color;
+	state->captured_piece = captured_piece;
+	state->move_50_rule = previous_state->move_50_rule + 1;
+	state->turn = !color;
+	state->en_passant = SQ_NONE;
 
-	state->captured_piece = (
-		move.move_type == EN_PASSANT
-		? make_piece(!color, PAWN) : piece_on(pos, move.destination)
+	state->key = (
+		previous_state->key ^ side_key
+		^ en_passant_key(previous_state->en_passant)
 	);
 
-	state->move_50_rule = pos->state->move_50_rule + 1;
+	if(captured_piece) {
+		Square captured_sq = destination;
 
-	if(state->captured_piece) {
-		remove_piece(
-			pos,
-			state->captured_piece,
-			move.destination
-		);
+		if(move_type == EN_PASSANT)
+			captured_sq = destination - 8 + (color * 16);
 
+		remove_piece(pos, captured_piece, captured_sq);
+
+		state->key ^= piece_key(captured_piece, captured_sq);
 		state->move_50_rule = 0;
 	}
 
-	if(move.move_type == CASTLING) {
+	if(move_type == CASTLING) {
 		Castling castling = WHITE_OO << (2 * color);
 
 		do_castling(
 			pos,
-			castling << !!(
-				square_to_bitboard(move.destination) & FILE_C
-			)
+			castling << !!(square_to_bitboard(destination) & FILE_C)
 		);
 	} else {
-		move_piece(
-			pos,
-			make_piece(color, move.moved_piece_type),
-			move.source,
-			move.destination
+		move_piece(pos, piece, source, destination);
+
+		state->key ^= (
+			piece_key(piece, source) ^ piece_key(piece, destination)
 		);
 	}
 
-	if(move.moved_piece_type == PAWN) {
-		if(move.move_type == EN_PASSANT) {
-			remove_piece(
-				pos,
-				make_piece(!color, PAWN),
-				move.destination - 8 + (color * 16)
-			);
-		} else if(move.move_type == PROMOTION) {
-			set_piece(
-				pos,
-				make_piece(
-					color,
-					move.promotion_piece_type
-				),
-				move.destination
+	if(type_of_piece(piece) == PAWN) {
+		if(move_type == PROMOTION) {
+			Piece promoted = make_piece(
+				color, promotion_of_move(move)
 			);
 
-			remove_piece(
-				pos,
-				make_piece(color, PAWN),
-				move.destination
+			remove_piece(pos, piece, destination);
+			set_piece(pos, promoted, destination);
+
+			state->key ^= (
+				piece_key(piece, destination)
+				^ piece_key(promoted, destination)
 			);
+		} else if((source ^ destination) == 16) {
+			state->en_passant = (source + destination) / 2;
+			state->key ^= en_passant_key(state->en_passant);
 		}
 
 		state->move_50_rule = 0;
 	}
 
 	state->previous_move = move;
-	state->previous_state = pos->state;
 
-	state->castling = pos->state->castling;
+	state->castling = previous_state->castling;
 	state->castling &= ~(
-		castling_masks[move.source] | castling_masks[move.destination]
+		castling_masks[source] | castling_masks[destination]
 	);
 
-	pos->state = state;
-
-	state->allies = EMPTY;
-	state->enemies = EMPTY;
-
-	for(PieceType pt = PAWN; pt <= PIECE_TYPE_NB; pt++) {
-		state->allies |= pieces(pos, make_piece(!color, pt));
-		state->enemies |= pieces(pos, make_piece(color, pt));
-	}
+	state->key ^= (
+		castling_keys[previous_state->castling]
+		^ castling_keys[state->castling]
+	);
 
+	state->allies = pos->occupied_by[!color];
+	state->enemies = pos->occupied_by[color];
 	state->occupied = state->allies | state->enemies;
+
+	assert(state->key == generate_hash_key(pos));
 }
 
 void undo_move(Position *pos)
@@ -612,15 +745,16 @@ void undo_move(Position *pos)
 
 	Move last_move = pos->state->previous_move;
 
-	Color allies_color = last_move.color;
+	Color allies_color = !pos->state->turn;
 
-	Square source = last_move.source;
-	Square destination = last_move.destination;
+	Square source = source_of_move(last_move);
+	Square destination = destination_of_move(last_move);
+	MoveType move_type = type_of_move(last_move);
 
-	Piece piece = make_piece(allies_color, last_move.moved_piece_type);
+	Piece piece = pos->board_squares[destination];
 	Piece captured = pos->state->captured_piece;
 
-	if (last_move.move_type == CASTLING) {
+	if (move_type == CASTLING) {
 		bool king_side = destination > source;
 
 		Square rook_destination = destination + 1 - 2 * king_side;
@@ -652,38 +786,32 @@ void undo_move(Position *pos)
 		);
 	}
 
-	if (last_move.move_type == COMMON) {
+	if (move_type == COMMON) {
 		move_piece(pos, piece, destination, source);
 		if (captured) {
 			set_piece(pos, captured, destination);
 		}
 	}
 
-	if (last_move.move_type == EN_PASSANT) {
+	if (move_type == EN_PASSANT) {
 		move_piece(pos, piece, destination, source);
 		set_piece(pos, captured, destination - 8 + (16 * allies_color));
 	}
 
-	if (last_move.move_type == PROMOTION) {
-		set_piece(pos, piece, source);
-		remove_piece(
-			pos,
-			make_piece(allies_color, last_move.promotion_piece_type),
-			destination
-		);
+	if (move_type == PROMOTION) {
+		set_piece(pos, make_piece(allies_color, PAWN), source);
+		remove_piece(pos, piece, destination);
 		if (captured) {
 			set_piece(pos, captured, destination);
 		}
 	}
 
-	PositionState *temp = pos->state;
-	pos->state = pos->state->previous_state;
-	free(temp);
+	pop_state(pos);
 }
 
 U64 get_pinned(Position *pos)
 {
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 	Square king_sq = bit_scan_forward(
 		pieces(pos, make_piece(color, KING))
 	);
@@ -2,7 +2,9 @@
 #include "position.h"
 #include "evaluate.h"
 #include "movegen.h"
+#include "movepick.h"
 #include "search.h"
+#include "transposition.h"
 #include "uci.h"
 
 #include <assert.h>
@@ -10,24 +12,8 @@
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
-
-U64 nodes = 0;
-U64 ply = 0;
-
-uint8_t follow_PV = 0;
-uint8_t eval_PV = 0;
-
-/// Array for killer moves
-ExtMove killer_moves[2][MAX_PLY];
-
-/// Array with evaluation of history moves caused cutoff
-Evaluation history_moves[12][64];
-
-/// Lenght of the principle variation table
-uint32_t pv_lenght[MAX_PLY];
-
-/// Principle variation table
-Move pv_table[MAX_PLY][MAX_PLY];
+#include <pthread.h>
+#include <math.h>
 
 /// Full depth searching constant for LMR
 const uint32_t FULL_DEPTH_MOVES = 4;
@@ -35,6 +21,19 @@ const uint32_t FULL_DEPTH_MOVES = 4;
 /// Reduction limit in LMR
 const uint32_t REDUCTION_LIMIT = 3;
 
+/// Number of the move indices in the LMR table, later moves share the last
+#define REDUCTION_MOVES 64
+
+/// Late move reductions by depth and number of the moves searched before
+static int reductions[MAX_PLY][REDUCTION_MOVES];
+
+/// History score of a quiet move from which it is reduced by one ply less
+const Evaluation REDUCTION_HISTORY = 64;
+
+/// First depth searched with an aspiration window, the scores of the shallow
+/// iterations are too unstable for it
+const uint32_t ASPIRATION_DEPTH = 4;
+
 int cmp(const void *elem1, const void *elem2)
 {
 	ExtMove first = *((ExtMove*)elem1);
@@ -46,60 +45,268 @@ int cmp(const void *elem1, const void *elem2)
 	return 0;
 }
 
-// Function for comparing between two Move structures
-static inline int cmp_moves(Move move_1, Move move_2)
+// Mate scores are stored relative to the node, not to the root
+static inline Evaluation score_to_tt(Evaluation score, uint32_t ply)
 {
-	return (
-		move_1.color == move_2.color &&
-		move_1.destination == move_2.destination &&
-		move_1.moved_piece_type == move_2.moved_piece_type &&
-		move_1.move_type == move_2.move_type &&
-		move_1.promotion_piece_type == move_2.promotion_piece_type &&
-		move_1.source == move_2.source
-	);
+	if (score >= WHITE_WIN - MAX_PLY)
+		return score + ply;
+
+	if (score <= BLACK_WIN + MAX_PLY)
+		return score - ply;
+
+	return score;
 }
 
-ExtMove find_best(Position *position, uint32_t depth)
+static inline Evaluation score_from_tt(Evaluation score, uint32_t ply)
 {
-	assert(position != NULL);
+	if (score >= WHITE_WIN - MAX_PLY)
+		return score - ply;
 
-	ExtMove best_move = {
-		.eval = BLACK_WIN
-	};
+	if (score <= BLACK_WIN + MAX_PLY)
+		return score + ply;
+
+	return score;
+}
+
+void init_reductions(void)
+{
+	// Reductions grow with both the depth and the move index, but slowly,
+	// so that even the last moves keep most of the depth
+	for (uint32_t depth = 1; depth < MAX_PLY; depth++) {
+		for (uint32_t index = 1; index < REDUCTION_MOVES; index++) {
+			reductions[depth][index] = (
+				0.75 + log(depth) * log(index) / 2.25
+			);
+		}
+	}
+}
 
-	time_info.stopped = 0;
+void init_time_info(TimeInfo *time_info)
+{
+	assert(time_info != NULL);
 
-	nodes = 0;
-	ply = 0;
+	time_info->quit = 0;
+	time_info->time_set = 0;
+	time_info->stopped = 0;
 
-	memset(killer_moves, 0, sizeof(killer_moves));
-	memset(history_moves, 0, sizeof(history_moves));
+	time_info->moves_to_go = 30;
+	time_info->inc = 0;
 
-	memset(pv_table, 0, sizeof(pv_table));
-	memset(pv_lenght, 0, sizeof(pv_lenght));
+	time_info->start_time = 0;
+	time_info->stop_time = 0;
 
-	for (uint32_t curr_depth = 1; curr_depth <= depth; curr_depth++) {
-		if (time_info.stopped == 1)
-			break;
+	time_info->move_time = -1;
+	time_info->time_uci = -1;
+}
+
+SearchContext *init_search_context(uint32_t threads_nb)
+{
+	SearchContext *context = malloc(sizeof(SearchContext));
+
+	if (context == NULL)
+		return NULL;
+
+	init_time_info(&context->time);
+
+	context->uci = false;
+	context->generation = 0;
+
+	context->aspiration_delta = ASPIRATION_DELTA;
+
+	context->threads_nb = 0;
+	context->threads = NULL;
+
+	context->nodes = 0;
+	context->depth = 0;
+
+	if (!set_search_threads(context, threads_nb)) {
+		free(context);
+
+		return NULL;
+	}
+
+	return context;
+}
+
+void free_search_context(SearchContext *context)
+{
+	assert(context != NULL);
+
+	free(context->threads);
+	free(context);
+}
+
+bool set_search_threads(SearchContext *context, uint32_t threads_nb)
+{
+	assert(context != NULL);
+	assert(threads_nb > 0 && threads_nb <= MAX_THREADS);
+
+	if (threads_nb == context->threads_nb)
+		return true;
+
+	SearchThread *threads = malloc(threads_nb * sizeof(SearchThread));
+
+	if (threads == NULL)
+		return false;
+
+	free(context->threads);
+
+	context->threads = threads;
+	context->threads_nb = threads_nb;
+
+	return true;
+}
+
+void init_search_thread(
+	SearchThread *thread, SearchContext *context,
+	Position *pos, uint32_t id
+)
+{
+	assert(thread != NULL);
+	assert(context != NULL);
+	assert(pos != NULL);
+
+	thread->context = context;
+	thread->pos = pos;
+	thread->id = id;
+	thread->depth = 0;
+
+	thread->nodes = 0;
+	thread->ply = 0;
+
+	thread->follow_PV = 0;
+
+	memset(thread->killer_moves, 0, sizeof(thread->killer_moves));
+	memset(thread->history_moves, 0, sizeof(thread->history_moves));
+
+	memset(thread->pv_table, 0, sizeof(thread->pv_table));
+	memset(thread->pv_lenght, 0, sizeof(thread->pv_lenght));
+}
+
+/**
+ * \brief Searches the root with an aspiration window around the score of the
+ * previous iteration. On a fail the window is widened on the failing side
+ * with the delta doubled each time, until the score fits in it.
+ *
+ * \param thread search thread
+ *
+ * \param depth search depth
+ *
+ * \param previous score of the previous iteration
+ *
+ * \return score of the root
+ *
+ * \see https://www.chessprogramming.org/Aspiration_Windows
+ */
+static Evaluation aspiration_search(
+	SearchThread *thread, uint32_t depth, Evaluation previous
+)
+{
+	SearchContext *context = thread->context;
+
+	Evaluation delta = context->aspiration_delta;
+
+	Evaluation alpha = BLACK_WIN;
+	Evaluation beta = WHITE_WIN;
+
+	// Mate scores change with the depth, a window around them only fails
+	if (
+		delta > 0 && depth >= ASPIRATION_DEPTH
+		&& previous > BLACK_WIN + MAX_PLY
+		&& previous < WHITE_WIN - MAX_PLY
+	) {
+		alpha = previous - delta;
+		beta = previous + delta;
+	}
+
+	while (1) {
+		thread->follow_PV = 1;
+
+		Evaluation score = negamax(thread, depth, alpha, beta);
+
+		if (context->time.stopped == 1)
+			return score;
+
+		const char *bound;
+
+		if (score <= alpha && alpha > BLACK_WIN) {
+			alpha = score - delta;
+
+			if (alpha < BLACK_WIN)
+				alpha = BLACK_WIN;
+
+			bound = "upperbound";
+		} else if (score >= beta && beta < WHITE_WIN) {
+			beta = score + delta;
+
+			if (beta > WHITE_WIN)
+				beta = WHITE_WIN;
+
+			bound = "lowerbound";
+		} else {
+			return score;
+		}
 
-		follow_PV = 1;
+		delta *= 2;
 
-		Evaluation score = negamax(
-			position, curr_depth,
-			BLACK_WIN, WHITE_WIN
+		if (thread->id == 0 && context->uci)
+			printf(
+				"info score cp %d %s depth %d nodes %ld\n",
+				score, bound, depth, thread->nodes
+			);
+	}
+}
+
+/**
+ * \brief Iterative deepening of one thread up to SearchThread::depth. Only
+ * the main thread prints the search info, if the context is in the UCI mode.
+ *
+ * \return #ExtMove with the evaluation and the move of the last iteration
+ */
+static ExtMove iterative_deepening(SearchThread *thread)
+{
+	SearchContext *context = thread->context;
+
+	ExtMove best_move = {
+		.eval = BLACK_WIN
+	};
+
+	// Half of the helpers start one ply deeper, so that the threads
+	// don't search the same tree at the same time
+	uint32_t first_depth = 1 + (thread->id & 1);
+
+	for (
+		uint32_t curr_depth = first_depth;
+		curr_depth <= thread->depth;
+		curr_depth++
+	) {
+		if (context->time.stopped == 1)
+			break;
+
+		Evaluation score = aspiration_search(
+			thread, curr_depth, best_move.eval
 		);
 		best_move.eval = score;
-		best_move.move = pv_table[0][0];
+		best_move.move = thread->pv_table[0][0];
+
+		if (thread->id != 0)
+			continue;
+
+		if (context->time.stopped == 0)
+			context->depth = curr_depth;
+
+		if (!context->uci)
+			continue;
 
 		printf(
 			"info score cp %d depth %d nodes %ld pv ",
-			best_move.eval, curr_depth, nodes
+			best_move.eval, curr_depth, thread->nodes
 		);
 
-		for (uint32_t i = 0; i < pv_lenght[0]; i++) {
+		for (uint32_t i = 0; i < thread->pv_lenght[0]; i++) {
 			char str[6];
 
-			move_to_str(pv_table[0][i], str);
+			move_to_str(thread->pv_table[0][i], str);
 			printf("%s ", str);
 		}
 
@@ -110,13 +317,82 @@ ExtMove find_best(Position *position, uint32_t depth)
 	return best_move;
 }
 
-void sort_move_list(Position *pos, MoveList *move_list)
+static void *helper_thread(void *arg)
 {
-	assert(pos != NULL);
+	iterative_deepening(arg);
+
+	return NULL;
+}
+
+ExtMove find_best(
+	SearchContext *context, Position *position, uint32_t depth
+)
+{
+	assert(context != NULL);
+	assert(position != NULL);
+
+	context->time.stopped = 0;
+
+	context->nodes = 0;
+	context->depth = 0;
+
+	context->generation = tt_new_search();
+
+	uint32_t threads_nb = context->threads_nb;
+	SearchThread *threads = context->threads;
+
+	pthread_t *handles = malloc(threads_nb * sizeof(pthread_t));
+
+	assert(handles != NULL);
+
+	init_search_thread(&threads[0], context, position, 0);
+	threads[0].depth = depth;
+
+	// Helpers search their own copies of the position and share their
+	// results with the main thread only through the transposition table
+	for (uint32_t i = 1; i < threads_nb; i++) {
+		Position *copy = copy_position(position);
+
+		assert(copy != NULL);
+
+		init_search_thread(&threads[i], context, copy, i);
+		threads[i].depth = depth;
+
+		pthread_create(&handles[i], NULL, helper_thread, &threads[i]);
+	}
+
+	ExtMove best_move = iterative_deepening(&threads[0]);
+
+	// The main thread is done, the helpers are stopped
+	context->time.stopped = 1;
+
+	context->nodes = threads[0].nodes;
+
+	for (uint32_t i = 1; i < threads_nb; i++) {
+		pthread_join(handles[i], NULL);
+
+		context->nodes += threads[i].nodes;
+
+		free_position(threads[i].pos);
+	}
+
+	free(handles);
+
+	tt_end_search();
+
+	return best_move;
+}
+
+void sort_move_list(SearchThread *thread, MoveList *move_list, Move hash_move)
+{
+	assert(thread != NULL);
 	assert(move_list != NULL);
 
 	for (uint32_t i = 0; i < ml_len(move_list); i++) {
-		evaluate_move(pos, &move_list->move_list[i]);
+		evaluate_move(thread, &move_list->move_list[i]);
+
+		if (hash_move == move_list->move_list[i].move)
+			move_list->move_list[i].eval = HASH_MOVE_EVAL;
 	}
 
 	qsort(
@@ -127,162 +403,196 @@ void sort_move_list(Position *pos, MoveList *move_list)
 	);
 }
 
-void evaluate_move(Position *pos, ExtMove *move)
+void evaluate_move(SearchThread *thread, ExtMove *move)
 {
-	assert(pos != NULL);
+	assert(thread != NULL);
 
-	if (eval_PV) {
-		if (cmp_moves(pv_table[0][ply], move->move)) {
-			eval_PV = 0;
+	Position *pos = thread->pos;
+	U64 ply = thread->ply;
 
-			move->eval = 20000;
-		}
-	}
+	Square source = source_of_move(move->move);
+	Square target = destination_of_move(move->move);
 
-	if (
-		piece_on(pos, move->move.destination) != NO_PIECE
-		|| move->move.move_type == EN_PASSANT
-	)
+	Piece piece = piece_on(pos, source);
+	Piece captured = piece_on(pos, target);
+
+	if (captured != NO_PIECE || type_of_move(move->move) == EN_PASSANT)
 	{
 		PieceType victim = PAWN;
-		PieceType attacker = move->move.moved_piece_type;
+		PieceType attacker = type_of_piece(piece);
 
-		if (move->move.move_type != EN_PASSANT) {
-			victim = type_of_piece(
-				piece_on(pos, move->move.destination)
-			);
-		}
+		if (type_of_move(move->move) != EN_PASSANT)
+			victim = type_of_piece(captured);
 
 		move->eval = mvv_lva[attacker - 1][victim - 1] + 10000;
 	}
 
 	else {
 		// Evaluate quite moves
-		assert(piece_on(pos, move->move.destination) != W_KING);
-
-		if (cmp_moves(killer_moves[0][ply].move, move->move))
+		if (thread->killer_moves[0][ply] == move->move)
 			move->eval = 9000;
 
-		else if (cmp_moves(killer_moves[1][ply].move, move->move))
+		else if (thread->killer_moves[1][ply] == move->move)
 			move->eval = 8000;
 
 		else {
-			PieceType pt = move->move.moved_piece_type - 1;
-			Color color = move->move.color + 1;
-			Square target = move->move.destination;
-
-			move->eval = history_moves[pt * color][target];
+			move->eval = thread->history_moves[
+				history_index(piece)
+			][target];
 		}
 	}
 }
 
-void complete_pv_evaluation(MoveList *move_list)
+Evaluation quiescence(
+	SearchThread *thread,
+	Evaluation alpha, Evaluation beta
+)
 {
-	follow_PV = 0;
+	assert(thread != NULL);
 
-	for (uint32_t i = 0; i < ml_len(move_list); i++) {
-		if (cmp_moves(pv_table[0][ply], move_list->move_list[i].move)) {
-			eval_PV = 1;
+	Position *pos = thread->pos;
 
-			follow_PV = 1;
-		}
-	}
-}
+	// Only the main thread reads the input, the helpers are stopped by it
+	if (thread->id == 0 && (thread->nodes & 2047) == 0)
+		communicate(thread->context);
 
-Evaluation quiescence(Position *pos, Evaluation alpha, Evaluation beta)
-{
-	assert(pos != NULL);
+	thread->nodes++;
 
-	if ((nodes & 2047) == 0)
-		communicate();
+	Color color = pos->state->turn;
 
-	nodes++;
+	CheckInfo check_info;
 
-	Color color = !pos->state->previous_move.color;
-	Evaluation stand_pat = evaluate_position(pos) * (color ? -1 : 1);
+	init_check_info(pos, &check_info);
 
-	if (stand_pat >= beta)
-		return beta;
-	if (alpha < stand_pat)
-		alpha = stand_pat;
+	// In check every evasion is searched, standing pat is not an option
+	if (check_info.checkers == EMPTY) {
+		Evaluation stand_pat = evaluate_position(pos) * (color ? -1 : 1);
 
-	MoveList *move_list = generate_all_moves(pos);
-	sort_move_list(pos, move_list);
+		if (stand_pat >= beta)
+			return beta;
+		if (alpha < stand_pat)
+			alpha = stand_pat;
+	}
 
-	if(ml_len(move_list) == 0) {
-		free(move_list);
+	if (thread->ply > MAX_PLY - 1)
+		return alpha;
 
-		if(get_check_type(pos))
-			return (color ? WHITE_WIN : BLACK_WIN) + ply;
-		else
-			return DRAW;
-	}
+	MoveList *move_list = &thread->move_stack[thread->ply];
+
+	ml_clear(move_list);
+	generate_pseudo_legal(
+		pos, &check_info, move_list,
+		check_info.checkers == EMPTY ? GEN_CAPTURES : GEN_ALL
+	);
+
+	sort_move_list(thread, move_list, MOVE_NONE);
+
+	uint32_t legal_moves = 0;
+
+	for (uint32_t i = 0; i < ml_len(move_list); i++) {
+		Move current_move = move_list->move_list[i].move;
 
-	while(ml_len(move_list)) {
-		Move current_move = ml_pop(move_list).move;
+		if (!is_legal(pos, &check_info, current_move))
+			continue;
 
-		ply++;
+		legal_moves++;
 
-		if(
-			piece_on(pos, current_move.destination) == NO_PIECE
-			|| current_move.move_type != EN_PASSANT
+		// Captures losing material can't raise alpha above the stand pat
+		if (
+			check_info.checkers == EMPTY
+			&& type_of_move(current_move) == COMMON
+			&& static_exchange(pos, current_move) < 0
 		)
-		{
-			ply--;
 			continue;
-		}
 
 		do_move(pos, current_move);
 
+		thread->ply++;
+
 		Evaluation score = -quiescence(
-			pos, -beta, -alpha
+			thread, -beta, -alpha
 		);
 
-		ply--;
+		thread->ply--;
 
 		undo_move(pos);
 
-		if (time_info.stopped == 1)
+		if (thread->context->time.stopped == 1)
 			return NO_EVAL;
 
-		if(score >= beta) {
-			free(move_list);
+		if(score >= beta)
 			return beta;
-		}
 
 		if(score > alpha)
 			alpha = score;
 	}
 
-	free(move_list);
+	// Scores are relative to the side to move, as in negamax()
+	if (check_info.checkers != EMPTY && legal_moves == 0)
+		return BLACK_WIN + thread->ply;
 
 	return alpha;
 }
 
 Evaluation negamax(
-	Position *pos, uint32_t depth,
+	SearchThread *thread, uint32_t depth,
 	Evaluation alpha, Evaluation beta
 )
 {
-	assert(pos != NULL);
+	assert(thread != NULL);
+
+	Position *pos = thread->pos;
+	U64 ply = thread->ply;
 
-	if ((nodes & 2047) == 0)
-		communicate();
+	if (thread->id == 0 && (thread->nodes & 2047) == 0)
+		communicate(thread->context);
 
 	uint32_t moves_searched = 0;
 
 	Evaluation max_score = BLACK_WIN;
 
-	pv_lenght[ply] = ply;
+	// The PV table and the other per ply arrays end here
+	if (ply > MAX_PLY - 1)
+		return evaluate_position(pos);
+
+	thread->pv_lenght[ply] = ply;
+
+	// The game ends in a draw, the line is not worth searching
+	if (ply && is_draw(pos))
+		return DRAW;
 
 	if (depth == 0) {
-		return quiescence(pos, alpha, beta);
+		return quiescence(thread, alpha, beta);
 	}
 
-	if (ply > MAX_PLY - 1)
-		return evaluate_position(pos);
+	thread->nodes++;
+
+	U64 key = pos->state->key;
+	uint32_t tt_depth = depth;
+
+	Evaluation original_alpha = alpha;
 
-	nodes++;
+	Move hash_move = MOVE_NONE;
+	Move best_move = MOVE_NONE;
+
+	TTData entry;
+
+	if (tt_probe(key, &entry)) {
+		hash_move = entry.move;
+
+		// Cutoffs only at non-PV nodes, so that the PV stays complete
+		if (ply && beta - alpha == 1 && entry.depth >= depth) {
+			Evaluation score = score_from_tt(entry.score, ply);
+			Bound bound = tt_bound(&entry);
+
+			if (
+				bound == BOUND_EXACT
+				|| (bound == BOUND_LOWER && score >= beta)
+				|| (bound == BOUND_UPPER && score <= alpha)
+			)
+				return score;
+		}
+	}
 
 	if (get_check_type(pos) != NO_CHECK)
 		depth++;
@@ -294,121 +604,202 @@ Evaluation negamax(
 		do_null_move(pos);
 
 		Evaluation score = -negamax(
-			pos, depth - 1 - 2, -beta, -beta + 1
+			thread, depth - 1 - 2, -beta, -beta + 1
 		);
 
 		undo_null_move(pos);
 
-		if (time_info.stopped == 1)
+		if (thread->context->time.stopped == 1)
 			return NO_EVAL;
 
-		if (score >= beta)
+		if (score >= beta) {
+			tt_store(
+				key, tt_depth, BOUND_LOWER,
+				score_to_tt(beta, ply), MOVE_NONE,
+				thread->context->generation
+			);
+
 			return beta;
+		}
 	}
 
-	MoveList *move_list = generate_all_moves(pos);
+	// While following the PV of the previous iteration its move is searched
+	// first. Past the end of the PV the hash move is kept.
+	if (thread->follow_PV) {
+		if (thread->pv_table[0][ply] != MOVE_NONE)
+			hash_move = thread->pv_table[0][ply];
+		else
+			thread->follow_PV = 0;
+	}
 
-	if (follow_PV)
-		complete_pv_evaluation(move_list);
+	MovePicker picker;
 
-	sort_move_list(pos, move_list);
+	init_move_picker(
+		&picker, pos, &thread->move_stack[ply], hash_move,
+		thread->killer_moves[0][ply], thread->killer_moves[1][ply],
+		thread->history_moves
+	);
 
-	for (uint32_t i = 0; i < ml_len(move_list); i++) {
-		Move current_move = move_list->move_list[i].move;
+	if (thread->follow_PV)
+		thread->follow_PV = picker.hash_move != MOVE_NONE;
+
+	Move current_move;
+
+	while ((current_move = next_move(&picker)) != MOVE_NONE) {
+		if (!is_legal(pos, &picker.check_info, current_move))
+			continue;
+
+		Square target = destination_of_move(current_move);
+
+		bool quiet = (
+			piece_on(pos, target) == NO_PIECE
+			&& type_of_move(current_move) != EN_PASSANT
+			&& promotion_of_move(current_move) == NO_PIECE_TYPE
+		);
+
+		Piece piece = piece_on(pos, source_of_move(current_move));
+
+		Evaluation history = thread->history_moves[
+			history_index(piece)
+		][target];
 
 		do_move(pos, current_move);
 
-		ply++;
+		thread->ply++;
 
 		Evaluation score = NO_EVAL;
 
+		// Principal variation search: the first move is searched with
+		// the full window, the others with a zero window to prove they
+		// are worse, and only the ones that aren't are searched again
 		if (moves_searched == 0)
-			score = -negamax(pos, depth - 1, -beta, -alpha);
+			score = -negamax(thread, depth - 1, -beta, -alpha);
 
 		else {
-			Piece capture = piece_on(pos, current_move.destination);
-			PieceType pt = current_move.promotion_piece_type;
+			int reduction = 0;
 
 			if (
-				moves_searched >= FULL_DEPTH_MOVES &&
-				depth >= REDUCTION_LIMIT &&
-				get_check_type(pos) == NO_CHECK &&
-				capture == NO_PIECE &&
-				pt == NO_PIECE_TYPE
-			)
-				score = -negamax(pos, depth - 1, -beta, -alpha);
-			else
-				score = alpha + 1;
+				moves_searched >= FULL_DEPTH_MOVES
+				&& depth >= REDUCTION_LIMIT
+				&& quiet
+				&& picker.check_info.checkers == EMPTY
+				&& get_check_type(pos) == NO_CHECK
+			) {
+				reduction = reductions[
+					depth < MAX_PLY ? depth : MAX_PLY - 1
+				][
+					moves_searched < REDUCTION_MOVES
+					? moves_searched : REDUCTION_MOVES - 1
+				];
+
+				// Killers, moves with a good history and moves
+				// of PV nodes are reduced less
+				if (
+					current_move == picker.killers[0]
+					|| current_move == picker.killers[1]
+				)
+					reduction--;
+
+				if (history >= REDUCTION_HISTORY)
+					reduction--;
+
+				if (beta - alpha > 1)
+					reduction--;
+
+				if (reduction < 0)
+					reduction = 0;
+
+				// At least one ply is left before quiescence
+				if (reduction > (int)depth - 2)
+					reduction = depth - 2;
+			}
+
+			score = -negamax(
+				thread, depth - 1 - reduction,
+				-alpha - 1, -alpha
+			);
 
-			if (score > alpha) {
+			// A reduced move that beats alpha gets the full depth
+			if (reduction > 0 && score > alpha)
 				score = -negamax(
-					pos, depth - 1, -alpha - 1, -alpha
+					thread, depth - 1, -alpha - 1, -alpha
+				);
+
+			if (score > alpha && score < beta)
+				score = -negamax(
+					thread, depth - 1, -beta, -alpha
 				);
-				if (score > alpha && score < beta)
-					score = -negamax(
-						pos, depth - 1,
-						-beta, -alpha
-					);
-			}
 		}
 
-		ply--;
+		thread->ply--;
 
-		if (score > max_score)
+		if (score > max_score) {
 			max_score = score;
+			best_move = current_move;
+		}
 
 		undo_move(pos);
 
-		if (time_info.stopped == 1)
+		if (thread->context->time.stopped == 1)
 			return NO_EVAL;
 
 		moves_searched++;
 
 		if (max_score > alpha) {
 			// History heuristic
-			PieceType pt = current_move.moved_piece_type - 1;
-			Color color = current_move.color + 1;
-			Square target = current_move.destination;
-
-			if (piece_on(pos, target) == NO_PIECE)
-				history_moves[pt * color][target] += depth;
+			if (quiet)
+				thread->history_moves[history_index(piece)][
+					target
+				] += depth;
 
 			alpha = max_score;
 
 			// PV Table
+			Move (*pv_table)[MAX_PLY] = thread->pv_table;
+			uint32_t *pv_lenght = thread->pv_lenght;
+
 			pv_table[ply][ply] = current_move;
 
-			uint32_t next_ply = ply + 1;
+			// The child at the last ply returns without a PV
+			uint32_t child_lenght = (
+				ply + 1 < MAX_PLY ? pv_lenght[ply + 1] : ply + 1
+			);
 
-			for (; next_ply < pv_lenght[ply + 1]; next_ply++) {
-				Move deep_move = pv_table[ply + 1][next_ply];
-				pv_table[ply][next_ply] = deep_move;
-			}
+			for (uint32_t i = ply + 1; i < child_lenght; i++)
+				pv_table[ply][i] = pv_table[ply + 1][i];
 
-			pv_lenght[ply] = pv_lenght[ply + 1];
+			pv_lenght[ply] = child_lenght;
 		}
 
 		if (alpha >= beta) {
-			ExtMove ext_move = move_list->move_list[i];
-			Square target = ext_move.move.destination;
-
-			if (piece_on(pos, target) == NO_PIECE) {
-				killer_moves[1][ply] = killer_moves[0][ply];
-				killer_moves[0][ply] = ext_move;
+			if (quiet) {
+				thread->killer_moves[1][ply] =
+					thread->killer_moves[0][ply];
+				thread->killer_moves[0][ply] = current_move;
 			}
 
 			break;
 		}
 	}
 
-	if(ml_len(move_list) == 0) {
+	if(moves_searched == 0) {
 		if(get_check_type(pos))
 			max_score = BLACK_WIN + ply;
 		else
 			max_score = DRAW;
 	}
 
-	free(move_list);
+	Bound bound = BOUND_EXACT;
+
+	if (max_score <= original_alpha)
+		bound = BOUND_UPPER;
+	else if (max_score >= beta)
+		bound = BOUND_LOWER;
+
+	tt_store(
+		key, tt_depth, bound, score_to_tt(max_score, ply), best_move,
+		thread->context->generation
+	);
 
 	return max_score;
 }
@@ -0,0 +1,225 @@
+#include "bitboard.h"
+#include "position.h"
+#include "evaluate.h"
+#include "transposition.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+TranspositionTable tt = {
+	.buckets = NULL, .bucket_count = 0,
+	.generation = 0, .searches = 0,
+	.memory = NULL
+};
+
+/// Returns the generation of the search which stored the entry
+#define tt_generation(entry) ((entry)->bound_age >> 2)
+
+/**
+ * \brief Packs the entry content into one word
+ */
+static inline U64 tt_pack(TTData data)
+{
+	return (
+		(U64)(uint32_t)data.score
+		| (U64)data.move << 32
+		| (U64)data.depth << 48
+		| (U64)data.bound_age << 56
+	);
+}
+
+/**
+ * \brief Unpacks the word made by tt_pack()
+ */
+static inline TTData tt_unpack(U64 packed)
+{
+	return (TTData) {
+		.score = (int32_t)(uint32_t)packed,
+		.move = (Move)(packed >> 32),
+		.depth = (uint8_t)(packed >> 48),
+		.bound_age = (uint8_t)(packed >> 56),
+	};
+}
+
+/**
+ * \brief Reads the entry with one atomic load of each word
+ *
+ * \param entry entry
+ *
+ * \param key out parameter, key of the entry, garbage if it is torn
+ *
+ * \return content of the entry
+ */
+static inline TTData tt_load(TTEntry *entry, U64 *key)
+{
+	U64 data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+	U64 check = atomic_load_explicit(
+		&entry->key_xor_data, memory_order_relaxed
+	);
+
+	*key = check ^ data;
+
+	return tt_unpack(data);
+}
+
+bool tt_resize(size_t megabytes)
+{
+	assert(megabytes <= TT_MAX_SIZE);
+
+	if (tt.searches != 0)
+		return false;
+
+	tt_free();
+
+	U64 bucket_count = 1;
+
+	while (bucket_count * 2 * sizeof(TTBucket) <= megabytes << 20)
+		bucket_count *= 2;
+
+	// Over-allocate by one cache line to align the buckets to it
+	tt.memory = calloc(1, bucket_count * sizeof(TTBucket) + 63);
+
+	if (tt.memory == NULL)
+		return false;
+
+	tt.buckets = (TTBucket *)(((uintptr_t)tt.memory + 63) & ~(uintptr_t)63);
+	tt.bucket_count = bucket_count;
+	tt.generation = 0;
+
+	return true;
+}
+
+void tt_free(void)
+{
+	free(tt.memory);
+
+	tt.memory = NULL;
+	tt.buckets = NULL;
+	tt.bucket_count = 0;
+}
+
+void tt_clear(void)
+{
+	assert(tt.searches == 0);
+
+	if (tt.searches != 0)
+		return;
+
+	if (tt.buckets != NULL)
+		memset(tt.buckets, 0, tt.bucket_count * sizeof(TTBucket));
+
+	tt.generation = 0;
+}
+
+uint8_t tt_new_search(void)
+{
+	atomic_fetch_add(&tt.searches, 1);
+
+	// Only the six low bits are stored in the entries
+	return (atomic_fetch_add(&tt.generation, 1) + 1) & 63;
+}
+
+void tt_end_search(void)
+{
+	assert(tt.searches > 0);
+
+	atomic_fetch_sub(&tt.searches, 1);
+}
+
+bool tt_probe(U64 key, TTData *data)
+{
+	assert(data != NULL);
+
+	if (tt.bucket_count == 0)
+		return false;
+
+	TTEntry *entries = tt.buckets[key & (tt.bucket_count - 1)].entries;
+
+	for (uint32_t i = 0; i < TT_BUCKET_SIZE; i++) {
+		U64 entry_key;
+		TTData entry = tt_load(&entries[i], &entry_key);
+
+		if (entry_key == key && tt_bound(&entry) != BOUND_NONE) {
+			*data = entry;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * \brief Returns how valuable the entry is. Deep entries of the current
+ * search are the most valuable, the least valuable entry is replaced first.
+ *
+ * \param entry content of the entry
+ *
+ * \param generation generation of the current search
+ */
+static inline int32_t replacement_value(
+	const TTData *entry, uint8_t generation
+)
+{
+	int32_t age = (generation - tt_generation(entry)) & 63;
+
+	return entry->depth - 8 * age;
+}
+
+void tt_store(
+	U64 key, uint32_t depth, Bound bound,
+	Evaluation score, Move move, uint8_t generation
+)
+{
+	assert(bound != BOUND_NONE);
+
+	if (tt.bucket_count == 0)
+		return;
+
+	TTEntry *entries = tt.buckets[key & (tt.bucket_count - 1)].entries;
+
+	TTEntry *replace = NULL;
+	TTData replace_data;
+	U64 replace_key = 0;
+
+	for (uint32_t i = 0; i < TT_BUCKET_SIZE; i++) {
+		U64 entry_key;
+		TTData entry = tt_load(&entries[i], &entry_key);
+
+		if (entry_key == key || tt_bound(&entry) == BOUND_NONE) {
+			replace = &entries[i];
+			replace_data = entry;
+			replace_key = entry_key;
+			break;
+		}
+
+		if (
+			replace == NULL
+			|| replacement_value(&entry, generation)
+			< replacement_value(&replace_data, generation)
+		) {
+			replace = &entries[i];
+			replace_data = entry;
+			replace_key = entry_key;
+		}
+	}
+
+	// Keep the old best move if the new search didn't find one
+	if (move == MOVE_NONE && replace_key == key)
+		move = replace_data.move;
+
+	U64 data = tt_pack((TTData) {
+		.score = score,
+		.move = move,
+		.depth = depth > UINT8_MAX ? UINT8_MAX : depth,
+		.bound_age = bound | (generation << 2),
+	});
+
+	atomic_store_explicit(&replace->data, data, memory_order_relaxed);
+	atomic_store_explicit(
+		&replace->key_xor_data, key ^ data, memory_order_relaxed
+	);
+}
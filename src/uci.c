@@ -5,6 +5,8 @@
 #include "patterns.h"
 #include "uci.h"
 #include "search.h"
+#include "transposition.h"
+#include "perft.h"
 
 #include <assert.h>
 #include <string.h>
@@ -19,10 +21,6 @@
 	#include <sys/time.h>
 #endif
 
-TimeInfo time_info = {
-	.moves_to_go = 30, .move_time = -1, .time_uci = -1
-};
-
 static char piece_symbol[PIECE_TYPE_NB + 1] = {
 	' ', 'p', 'n', 'b', 'r', 'q', 'k'
 };
@@ -88,15 +86,17 @@ int input_waiting(void)
 #endif // WIN32
 }
 
-void read_input(void)
+void read_input(TimeInfo *time_info)
 {
+	assert(time_info != NULL);
+
 	int bytes;
 
 	char input[256] = "", *endc;
 
 	if (input_waiting())
 	{
-		time_info.stopped = 1;
+		time_info->stopped = 1;
 
 		do
 		{
@@ -111,23 +111,28 @@ void read_input(void)
 		{
 			if (!strncmp(input, "quit", 4))
 			{
-				time_info.quit = 1;
+				time_info->quit = 1;
 			}
 
 			else if (!strncmp(input, "stop", 4))    {
-				time_info.quit = 1;
+				time_info->quit = 1;
 			}
 		}
 	}
 }
 
-void communicate(void)
+void communicate(SearchContext *context)
 {
+	assert(context != NULL);
+
+	TimeInfo *time_info = &context->time;
+
 	// if time is up break here
-	if (time_info.time_set == 1 && get_time_ms() > time_info.stop_time)
-		time_info.stopped = 1;
+	if (time_info->time_set == 1 && get_time_ms() > time_info->stop_time)
+		time_info->stopped = 1;
 
-	read_input();
+	if (context->uci)
+		read_input(time_info);
 }
 
 Move str_to_move(Position *pos, char *str)
@@ -141,52 +146,29 @@ Move str_to_move(Position *pos, char *str)
 	Square source_sq = (str[0] - 'a') + (str[1] - '1') * 8;
 	Square target_sq = (str[2] - 'a') + (str[3] - '1') * 8;
 
-	Piece piece = piece_on(pos, source_sq);
-	Color color = color_of_piece(piece);
-
-	Move move;
+	PieceType piece_type = type_of_piece(piece_on(pos, source_sq));
 
-	move.source = source_sq;
-	move.destination = target_sq;
-	move.color = color;
-	move.moved_piece_type = type_of_piece(piece);
+	MoveType move_type = COMMON;
+	PieceType promotion_pt = NO_PIECE_TYPE;
 
 	if (size == 4) {
-		Move last_move = pos->state->previous_move;
-
-		Square dst = last_move.destination;
-		Square src = last_move.source;
-
 		U64 target_bb = square_to_bitboard(target_sq);
-		U64 king_moves = king_move_pattern(source_sq);
+		U64 king_moves = king_attacks[source_sq];
 
 		uint32_t is_castling = !(king_moves & target_bb);
 
-		if (type_of_piece(piece) == KING && is_castling) {
-			move.move_type = CASTLING;
-		}
+		if (piece_type == KING && is_castling)
+			move_type = CASTLING;
 
 		else if (
-			last_move.moved_piece_type == PAWN
-			&& type_of_piece(piece) == PAWN
-			&& (dst > src ? dst - src : src - dst) == 16
-			&& target_sq == (dst + 8 - (16 * color))
+			piece_type == PAWN
+			&& target_sq == pos->state->en_passant
 		)
-		{
-			move.move_type = EN_PASSANT;
-		}
-
-		else {
-			move.move_type = COMMON;
-		}
-
-		move.promotion_piece_type = NO_PIECE_TYPE;
+			move_type = EN_PASSANT;
 	}
 
 	else if (size == 5) {
-		move.move_type = PROMOTION;
-
-		PieceType promotion_pt = NO_PIECE_TYPE;
+		move_type = PROMOTION;
 
 		if (str[4] == 'n')
 			promotion_pt = KNIGHT;
@@ -194,26 +176,20 @@ Move str_to_move(Position *pos, char *str)
 			promotion_pt = BISHOP;
 		else if (str[4] == 'r')
 			promotion_pt = ROOK;
-		else if (str[4] == 'q')
+		else
 			promotion_pt = QUEEN;
-
-		move.promotion_piece_type = promotion_pt;
 	}
 
-	return move;
+	return make_move(source_sq, target_sq, move_type, promotion_pt);
 }
 
 void move_to_str(Move move, char *str)
 {
-	assert(move.moved_piece_type != NO_PIECE_TYPE);
-	assert(move.color < COLOR_NB);
-	assert(move.destination < SQ_NB);
-	assert(move.source < SQ_NB);
-
+	assert(move != MOVE_NONE);
 	assert(str != NULL);
 
-	Square source = move.source;
-	Square destination = move.destination;
+	Square source = source_of_move(move);
+	Square destination = destination_of_move(move);
 
 	char source_rank = '1' + source / 8;
 	char destination_rank = '1' + destination / 8;
@@ -226,17 +202,10 @@ void move_to_str(Move move, char *str)
 	str[2] = destination_file;
 	str[3] = destination_rank;
 
-	if (move.move_type == PROMOTION) {
-		PieceType pt = move.promotion_piece_type;
-
-		if(pt < KNIGHT || pt > QUEEN)
-			str[4] = '\0';
-		else
-			str[4] = piece_symbol[pt];
-
-	} else {
+	if (type_of_move(move) == PROMOTION)
+		str[4] = piece_symbol[promotion_of_move(move)];
+	else
 		str[4] = '\0';
-	}
 }
 
 Position *get_position(char *str)
@@ -315,67 +284,134 @@ Position *get_position(char *str)
 	return pos;
 }
 
-ExtMove get_go(Position *pos, char *command)
+ExtMove get_go(SearchContext *context, Position *pos, char *command)
 {
+	assert(context != NULL);
 	assert(pos != NULL);
 	assert(strlen(command) > 2);
 
+	TimeInfo *time_info = &context->time;
+
+	// Limits of the previous go command don't apply
+	init_time_info(time_info);
+
 	uint32_t depth = 0;
 
 	char *argument = NULL;
 
-	Color color = !pos->state->previous_move.color;
+	Color color = pos->state->turn;
 
 	if ((argument = strstr(command,"infinite"))) {}
 
 	if ((argument = strstr(command,"binc")) && color == BLACK)
-		time_info.inc = atoi(argument + 5);
+		time_info->inc = atoi(argument + 5);
 
 	if ((argument = strstr(command,"winc")) && color == WHITE)
-		time_info.inc = atoi(argument + 5);
+		time_info->inc = atoi(argument + 5);
 
 	if ((argument = strstr(command,"wtime")) && color == WHITE)
-		time_info.time_uci = atoi(argument + 6);
+		time_info->time_uci = atoi(argument + 6);
 
 	if ((argument = strstr(command,"btime")) && color == BLACK)
-		time_info.time_uci = atoi(argument + 6);
+		time_info->time_uci = atoi(argument + 6);
 
 	if ((argument = strstr(command,"movestogo")))
-		time_info.moves_to_go = atoi(argument + 10);
+		time_info->moves_to_go = atoi(argument + 10);
 
 	if ((argument = strstr(command,"movetime")))
-		time_info.move_time = atoi(argument + 9);
+		time_info->move_time = atoi(argument + 9);
 
 	if ((argument = strstr(command,"depth")))
 		depth = atoi(argument + 6);
 
-	if (time_info.move_time != -1) {
-		time_info.time_uci = time_info.move_time;
-		time_info.moves_to_go = 1;
+	if (time_info->move_time != -1) {
+		time_info->time_uci = time_info->move_time;
+		time_info->moves_to_go = 1;
 	}
 
-	time_info.start_time = get_time_ms();
+	time_info->start_time = get_time_ms();
 
-	if (time_info.time_uci != -1) {
-		time_info.time_set = 1;
+	if (time_info->time_uci != -1) {
+		time_info->time_set = 1;
 
-		time_info.time_uci /= time_info.moves_to_go;
-		time_info.time_uci -= 50;
-		time_info.stop_time = (
-			time_info.start_time
-			+ time_info.time_uci
-			+ time_info.inc
+		time_info->time_uci /= time_info->moves_to_go;
+		time_info->time_uci -= 50;
+		time_info->stop_time = (
+			time_info->start_time
+			+ time_info->time_uci
+			+ time_info->inc
 		);
 	}
 
 	if (depth == 0)
 		depth = 64;
 
-	ExtMove best_move = find_best(pos, depth);
+	ExtMove best_move = find_best(context, pos, depth);
 
 	return best_move;
 }
 
+void set_option(SearchContext *context, char *command)
+{
+	assert(context != NULL);
+	assert(command != NULL);
+
+	char *argument = NULL;
+
+	if ((argument = strstr(command, "name Hash value"))) {
+		int size = atoi(argument + 16);
+
+		if (size < 1)
+			size = 1;
+		else if (size > TT_MAX_SIZE)
+			size = TT_MAX_SIZE;
+
+		if (!tt_resize(size))
+			printf("info string failed to allocate %d MB hash\n", size);
+	}
+
+	if ((argument = strstr(command, "name Threads value"))) {
+		int threads = atoi(argument + 19);
+
+		if (threads < 1)
+			threads = 1;
+		else if (threads > MAX_THREADS)
+			threads = MAX_THREADS;
+
+		if (!set_search_threads(context, threads))
+			printf(
+				"info string failed to allocate %d threads\n",
+				threads
+			);
+	}
+
+	if ((argument = strstr(command, "name AspirationDelta value"))) {
+		int delta = atoi(argument + 27);
+
+		if (delta < 0)
+			delta = 0;
+		else if (delta > ASPIRATION_DELTA_MAX)
+			delta = ASPIRATION_DELTA_MAX;
+
+		context->aspiration_delta = delta;
+	}
+
+	if ((argument = strstr(command, "name PerftHash value"))) {
+		int size = atoi(argument + 21);
+
+		if (size < 0)
+			size = 0;
+		else if (size > TT_MAX_SIZE)
+			size = TT_MAX_SIZE;
+
+		if (!perft_table_resize(size))
+			printf(
+				"info string failed to allocate %d MB perft hash\n",
+				size
+			);
+	}
+}
+
 void uci_loop()
 {
 	setbuf(stdin, NULL);
@@ -386,6 +422,12 @@ void uci_loop()
 	Position *pos = init_position(STARTPOS);
 	ExtMove best_move;
 
+	SearchContext *context = init_search_context(1);
+
+	assert(context != NULL);
+
+	context->uci = true;
+
 	while (1) {
 		memset(input, 0, sizeof(input));
 		fflush(stdout);
@@ -402,16 +444,32 @@ void uci_loop()
 		}
 
 		else if (strncmp(input, "position", 8) == 0) {
+			free_position(pos);
+
 			pos = get_position(input);
-			generate_hash_key(pos);
 		}
 
 		else if (strncmp(input, "ucinewgame", 10) == 0) {
-			pos = get_position(STARTPOS);
+			free_position(pos);
+
+			pos = init_position(STARTPOS);
+
+			tt_clear();
+		}
+
+		else if (strncmp(input, "setoption", 9) == 0) {
+			set_option(context, input);
+		}
+
+		else if (strncmp(input, "go perft", 8) == 0) {
+			int depth = atoi(input + 9);
+
+			if (depth > 0 && depth < MAX_PLY)
+				perft_parallel(pos, depth, context->threads_nb);
 		}
 
 		else if (strncmp(input, "go", 2) == 0) {
-			best_move = get_go(pos, input);
+			best_move = get_go(context, pos, input);
 
 			char move[6] = ".....";
 			move_to_str(best_move.move, move);
@@ -426,10 +484,30 @@ void uci_loop()
 		else if (strncmp(input, "uci", 3) == 0) {
 			printf("id name byteboard\n");
 			printf("id author Shark && Duck\n");
+			printf(
+				"option name Hash type spin default %d "
+				"min 1 max %d\n",
+				TT_DEFAULT_SIZE, TT_MAX_SIZE
+			);
+			printf(
+				"option name Threads type spin default 1 "
+				"min 1 max %d\n",
+				MAX_THREADS
+			);
+			printf(
+				"option name AspirationDelta type spin "
+				"default %d min 0 max %d\n",
+				ASPIRATION_DELTA, ASPIRATION_DELTA_MAX
+			);
+			printf(
+				"option name PerftHash type spin default 0 "
+				"min 0 max %d\n",
+				TT_MAX_SIZE
+			);
 			printf("uciok\n");
 		}
 	}
 
-	free(pos->state);
-	free(pos);
+	free_search_context(context);
+	free_position(pos);
 }
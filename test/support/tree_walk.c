@@ -0,0 +1,46 @@
+#include "unity.h"
+#include "movegen.h"
+#include "tree_walk.h"
+
+#include <string.h>
+
+void walk_tree(
+	Position *pos, uint32_t depth, NodeCallback callback, void *data
+)
+{
+	callback(pos, data);
+
+	if (depth == 0)
+		return;
+
+	MoveList move_list;
+
+	TEST_ASSERT_NOT_NULL(generate_moves(pos, &move_list));
+
+	const PositionState *state = pos->state;
+	const U64 key = state->key;
+
+	Board board;
+	Piece board_squares[SQ_NB];
+	U64 occupied_by[COLOR_NB];
+
+	memcpy(&board, &pos->board, sizeof(board));
+	memcpy(board_squares, pos->board_squares, sizeof(board_squares));
+	memcpy(occupied_by, pos->occupied_by, sizeof(occupied_by));
+
+	for (ExtMove *ext = move_list.move_list; ext < move_list.last; ext++) {
+		do_move(pos, ext->move);
+		walk_tree(pos, depth - 1, callback, data);
+		undo_move(pos);
+
+		TEST_ASSERT_EQUAL_PTR(state, pos->state);
+		TEST_ASSERT_EQUAL_UINT64(key, pos->state->key);
+		TEST_ASSERT_EQUAL_MEMORY(&board, &pos->board, sizeof(board));
+		TEST_ASSERT_EQUAL_MEMORY(
+			board_squares, pos->board_squares, sizeof(board_squares)
+		);
+		TEST_ASSERT_EQUAL_MEMORY(
+			occupied_by, pos->occupied_by, sizeof(occupied_by)
+		);
+	}
+}
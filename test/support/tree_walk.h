@@ -0,0 +1,37 @@
+/**
+ * \file
+ */
+#ifndef __TREE_WALK_H__
+#define __TREE_WALK_H__
+
+#include "position.h"
+
+#include <stdint.h>
+
+/**
+ * \brief Function called by #walk_tree in every position of the move tree
+ *
+ * \param pos position of the node, must be left as it was
+ *
+ * \param data pointer passed to #walk_tree
+ */
+typedef void (*NodeCallback)(Position *pos, void *data);
+
+/**
+ * \brief Calls the callback in every position of the legal move tree up to
+ * the depth, the root included. After every undone move checks that the
+ * position is restored exactly as it was before the move.
+ *
+ * \param pos root position
+ *
+ * \param depth number of plies below the root
+ *
+ * \param callback function called in every node
+ *
+ * \param data pointer passed to the callback
+ */
+void walk_tree(
+	Position *pos, uint32_t depth, NodeCallback callback, void *data
+);
+
+#endif
@@ -37,3 +37,19 @@ void test_remove_lsb_macro(void)
 	remove_lsb(bitboard);
 	TEST_ASSERT_EQUAL_UINT64(bitboard, 0x00ULL);
 }
+
+void test_bit_scan_every_square(void)
+{
+	for(uint32_t i = 0; i < 64; i++) {
+		U64 bit = 0x01ULL << i;
+
+		TEST_ASSERT_EQUAL_UINT32(i, bit_scan_forward(bit));
+		TEST_ASSERT_EQUAL_UINT32(i, bit_scan_reverse(bit));
+		TEST_ASSERT_EQUAL_UINT32(i, bit_scan_forward(UNIVERSE << i));
+		TEST_ASSERT_EQUAL_UINT32(i, bit_scan_reverse(UNIVERSE >> (63 - i)));
+		TEST_ASSERT_EQUAL_UINT32(i + 1, population_count(UNIVERSE >> (63 - i)));
+	}
+
+	TEST_ASSERT_EQUAL_UINT32(32, population_count(LIGHT_SQUARES));
+	TEST_ASSERT_EQUAL_UINT32(32, population_count(DARK_SQUARES));
+}
@@ -18,6 +18,8 @@
 void test_init(void)
 {
 	init_rays();
+	init_patterns();
+	init_slider_attacks();
 }
 
 void test_evaluate_position()
@@ -26,15 +28,13 @@ void test_evaluate_position()
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_position(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("8/1qrk4/8/8/8/8/1BNK4/8 w - - 0 1");
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_position(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_evaluate_material(void)
@@ -43,15 +43,69 @@ void test_evaluate_material(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_material(pos, MIDDLEGAME));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("8/1qrk4/8/8/8/8/1BNK4/8 w - - 0 1");
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_material(pos, MIDDLEGAME));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+}
+
+void test_static_exchange(void)
+{
+	const Evaluation pawn = piece_type_value[MIDDLEGAME][PAWN - 1];
+	const Evaluation knight = piece_type_value[MIDDLEGAME][KNIGHT - 1];
+	const Evaluation queen = piece_type_value[MIDDLEGAME][QUEEN - 1];
+
+	// Undefended pawn
+	Position *pos = init_position(
+		"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1"
+	);
+
+	TEST_ASSERT_EQUAL(
+		pawn, static_exchange(pos, make_move(SQ_E1, SQ_E5, COMMON, 0))
+	);
+
+	free_position(pos);
+
+	// Knight for a pawn, the x-ray attackers don't win it back
+	pos = init_position(
+		"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1"
+	);
+
+	TEST_ASSERT_EQUAL(
+		pawn - knight,
+		static_exchange(pos, make_move(SQ_D3, SQ_E5, COMMON, 0))
+	);
+
+	free_position(pos);
+
+	// Queen trade, with and without a defender
+	pos = init_position("3rk3/8/8/3q4/8/8/8/3QK3 w - - 0 1");
+
+	TEST_ASSERT_EQUAL(
+		DRAW, static_exchange(pos, make_move(SQ_D1, SQ_D5, COMMON, 0))
+	);
+
+	free_position(pos);
+
+	pos = init_position("4k3/8/8/3q4/8/8/8/3QK3 w - - 0 1");
+
+	TEST_ASSERT_EQUAL(
+		queen, static_exchange(pos, make_move(SQ_D1, SQ_D5, COMMON, 0))
+	);
+
+	free_position(pos);
+
+	// Quiet move to an attacked square
+	pos = init_position("4k3/8/2p5/8/4N3/8/8/4K3 w - - 0 1");
+
+	TEST_ASSERT_EQUAL(
+		-knight, static_exchange(pos, make_move(SQ_E4, SQ_D5, COMMON, 0))
+	);
+
+	free_position(pos);
 }
 
 void test_evaluate_mobility(void)
@@ -62,15 +116,13 @@ void test_evaluate_mobility(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_mobility(pos, MIDDLEGAME));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("8/1k6/3b1n2/8/2q5/8/3K4/7R w - - 0 1");
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_mobility(pos, ENDGAME));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_evaluate_central_pawns(void)
@@ -79,15 +131,13 @@ void test_evaluate_central_pawns(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_central_pawns(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("K7/8/2p2p2/3pp3/4P3/2P5/8/k7 w - - 0 1");
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_central_pawns(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_evaluate_passed_pawns(void)
@@ -96,15 +146,13 @@ void test_evaluate_passed_pawns(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_passed_pawns(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("K7/6p1/6P1/8/8/6p1/8/k7 w - - 0 1");
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_passed_pawns(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_evaluate_doubled_pawns(void)
@@ -115,8 +163,7 @@ void test_evaluate_doubled_pawns(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_doubled_pawns(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"4k3/pp1pppp1/3p2p1/8/8/P2P2P1/P1PP1PP1/4K3 w - - 0 1"
@@ -124,8 +171,7 @@ void test_evaluate_doubled_pawns(void)
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_doubled_pawns(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_evaluate_king_position(void)
@@ -137,8 +183,7 @@ void test_evaluate_king_position(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_king_position(pos, MIDDLEGAME));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/8/r5kP/6P1/1R6/8/8/6K1 w - - 0 1"
@@ -146,8 +191,7 @@ void test_evaluate_king_position(void)
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_king_position(pos, ENDGAME));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_tempo(void)
@@ -158,8 +202,7 @@ void test_tempo(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, tempo(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"4k3/pp1pppp1/3p2p1/8/8/P2P2P1/P1PP1PP1/4K3 b - - 0 1"
@@ -167,8 +210,7 @@ void test_tempo(void)
 
 	TEST_ASSERT_LESS_THAN(DRAW, tempo(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_evaluate_space(void)
@@ -179,8 +221,7 @@ void test_evaluate_space(void)
 
 	TEST_ASSERT_GREATER_THAN(DRAW, evaluate_space(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbqkbnr/ppp2ppp/8/3pp3/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
@@ -188,6 +229,5 @@ void test_evaluate_space(void)
 
 	TEST_ASSERT_LESS_THAN(DRAW, evaluate_space(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
@@ -0,0 +1,313 @@
+#include "unity.h"
+#include "bitboard.h"
+#include "bitboard_mapping.h"
+#include "position.h"
+#include "piece.h"
+#include "rays.h"
+#include "patterns.h"
+#include "masks.h"
+#include "movegen.h"
+#include "hash.h"
+#include "tree_walk.h"
+
+#include <stdlib.h>
+
+// Initializing everything needed for tests
+void test_init(void)
+{
+	init_rays();
+	init_patterns();
+	init_slider_attacks();
+	init_hash_keys();
+}
+
+void test_init_hash_keys(void)
+{
+	U64 side = side_key;
+	U64 piece = piece_keys[11][SQ_H8];
+
+	init_hash_keys();
+
+	// Keys are the same after reinitialization
+	TEST_ASSERT_EQUAL_UINT64(side, side_key);
+	TEST_ASSERT_EQUAL_UINT64(piece, piece_keys[11][SQ_H8]);
+
+	// Every castling combination has its own key
+	for (uint32_t i = 0; i < 16; i++) {
+		TEST_ASSERT_NOT_EQUAL(0, castling_keys[i]);
+
+		for (uint32_t j = 0; j < i; j++)
+			TEST_ASSERT_NOT_EQUAL(castling_keys[j], castling_keys[i]);
+	}
+
+	for (uint32_t i = 0; i < 8; i++)
+		TEST_ASSERT_NOT_EQUAL(0, en_passant_keys[i]);
+}
+
+void test_generate_hash_key(void)
+{
+	Position *pos = init_position(
+		"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1"
+	);
+
+	U64 key = generate_hash_key(pos);
+
+	free_position(pos);
+
+	// Only the castling rights differ
+	pos = init_position("r3k2r/8/8/8/8/8/8/R3K2R w KQk - 0 1");
+
+	TEST_ASSERT_EQUAL_UINT64(
+		key ^ castling_keys[ALL_CASTLING] ^ castling_keys[
+			WHITE_OO | WHITE_OOO | BLACK_OO
+		],
+		generate_hash_key(pos)
+	);
+
+	free_position(pos);
+
+	// Only the side to move differs
+	pos = init_position("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1");
+
+	TEST_ASSERT_EQUAL_UINT64(key ^ side_key, generate_hash_key(pos));
+
+	free_position(pos);
+
+	// En passant square is keyed by the file
+	pos = init_position("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+
+	key = generate_hash_key(pos);
+
+	free_position(pos);
+
+	pos = init_position("4k3/8/8/3pP3/8/8/8/4K3 w - - 0 1");
+
+	TEST_ASSERT_EQUAL_UINT64(
+		key ^ en_passant_keys[file_of(SQ_D6)], generate_hash_key(pos)
+	);
+
+	free_position(pos);
+}
+
+/// Buckets of the low key bits in test_key_collisions(), a table index
+#define INDEX_BUCKETS_NB (1 << 12)
+
+/// Number of low key bits compared by test_key_collisions(), the birthday
+/// bound of the unique positions is about 300 partial collisions
+#define PARTIAL_KEY_BITS 26
+
+/// Key of the position and an independent fingerprint of the same position
+typedef struct KeyRecord {
+	U64 key;
+	U64 fingerprint;
+} KeyRecord;
+
+/// Growing array of the records collected by collect_key()
+typedef struct KeyRecords {
+	KeyRecord *records;
+	size_t count;
+	size_t capacity;
+} KeyRecords;
+
+/**
+ * \brief FNV-1a over the board and the state, independent of the zobrist
+ * keys, so two records with the same key and different fingerprints are
+ * different positions.
+ */
+static U64 fingerprint(const Position *pos)
+{
+	const unsigned char *bytes = (const unsigned char *)&pos->board;
+	U64 hash = 0xCBF29CE484222325ULL;
+
+	for (size_t i = 0; i < sizeof(Board); i++)
+		hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+
+	U64 extra[3] = {
+		pos->state->castling, pos->state->turn, pos->state->en_passant
+	};
+
+	for (size_t i = 0; i < 3; i++)
+		hash = (hash ^ extra[i]) * 0x100000001B3ULL;
+
+	return hash;
+}
+
+/**
+ * \brief Records the position in the #KeyRecords passed as data,
+ * #NodeCallback of test_key_collisions()
+ */
+static void collect_key(Position *pos, void *data)
+{
+	KeyRecords *keys = data;
+
+	if (keys->count == keys->capacity) {
+		keys->capacity = keys->capacity ? keys->capacity * 2 : 1024;
+
+		KeyRecord *records = realloc(
+			keys->records, keys->capacity * sizeof(KeyRecord)
+		);
+
+		if (records == NULL)
+			free(keys->records);
+
+		keys->records = records;
+
+		TEST_ASSERT_NOT_NULL(keys->records);
+	}
+
+	keys->records[keys->count++] = (KeyRecord) {
+		.key = pos->state->key, .fingerprint = fingerprint(pos)
+	};
+}
+
+static int compare_partial_keys(const void *a, const void *b)
+{
+	const U64 mask = (1ULL << PARTIAL_KEY_BITS) - 1;
+	const U64 x = ((const KeyRecord *)a)->key & mask;
+	const U64 y = ((const KeyRecord *)b)->key & mask;
+
+	return (x > y) - (x < y);
+}
+
+static int compare_records(const void *a, const void *b)
+{
+	const KeyRecord *x = a;
+	const KeyRecord *y = b;
+
+	if (x->key != y->key)
+		return x->key < y->key ? -1 : 1;
+
+	if (x->fingerprint != y->fingerprint)
+		return x->fingerprint < y->fingerprint ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * \brief Counts the pairs of records in the same run of equal masked keys,
+ * the records must be sorted by the masked key
+ */
+static size_t count_pairs(const KeyRecord *records, size_t count, U64 mask)
+{
+	size_t pairs = 0;
+	size_t run = 1;
+
+	for (size_t i = 1; i <= count; i++) {
+		if (
+			i < count
+			&& (records[i - 1].key & mask) == (records[i].key & mask)
+		) {
+			run++;
+			continue;
+		}
+
+		pairs += run * (run - 1) / 2;
+		run = 1;
+	}
+
+	return pairs;
+}
+
+/// Collision benchmark over about 200 thousand unique positions of several
+/// move trees, 360 thousand nodes. Checks that no two positions share a
+/// key, every key bit is balanced, the low bits used as a table index are
+/// uniformly distributed and the collisions of the low #PARTIAL_KEY_BITS
+/// bits match the birthday bound. A table indexed with the low bits of the
+/// key relies on all of these. The records are freed before the asserts.
+void test_key_collisions(void)
+{
+	const char *fens[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	};
+	const uint32_t depths[] = {4, 3, 4, 3};
+
+	KeyRecords keys = {NULL, 0, 0};
+
+	for (size_t i = 0; i < sizeof(depths) / sizeof(*depths); i++) {
+		Position *pos = init_position(fens[i]);
+
+		walk_tree(pos, depths[i], collect_key, &keys);
+
+		free_position(pos);
+	}
+
+	qsort(keys.records, keys.count, sizeof(KeyRecord), compare_records);
+
+	// Duplicates are transpositions, keep one record per position
+	size_t unique = 0;
+	size_t collisions = 0;
+
+	for (size_t i = 0; i < keys.count; i++) {
+		if (unique && keys.records[unique - 1].key == keys.records[i].key) {
+			collisions += (
+				keys.records[unique - 1].fingerprint
+				!= keys.records[i].fingerprint
+			);
+			continue;
+		}
+
+		keys.records[unique++] = keys.records[i];
+	}
+
+	uint32_t bit_count[64] = {0};
+	uint32_t buckets[INDEX_BUCKETS_NB] = {0};
+
+	for (size_t i = 0; i < unique; i++) {
+		for (uint32_t bit = 0; bit < 64; bit++)
+			bit_count[bit] += (keys.records[i].key >> bit) & 1;
+
+		buckets[keys.records[i].key & (INDEX_BUCKETS_NB - 1)]++;
+	}
+
+	uint32_t worst_bit = 0;
+
+	for (uint32_t bit = 0; bit < 64; bit++) {
+		uint32_t deviation = (
+			bit_count[bit] > unique / 2
+			? bit_count[bit] - unique / 2
+			: unique / 2 - bit_count[bit]
+		);
+
+		if (deviation > worst_bit)
+			worst_bit = deviation;
+	}
+
+	double expected = (double)unique / INDEX_BUCKETS_NB;
+	double chi_square = 0;
+
+	for (size_t i = 0; i < INDEX_BUCKETS_NB; i++) {
+		double diff = buckets[i] - expected;
+
+		chi_square += diff * diff / expected;
+	}
+
+	// The records are sorted by the full key, sort them by the low bits
+	qsort(keys.records, unique, sizeof(KeyRecord), compare_partial_keys);
+
+	const U64 mask = (1ULL << PARTIAL_KEY_BITS) - 1;
+
+	size_t partial = count_pairs(keys.records, unique, mask);
+	double partial_expected = (
+		(double)unique * (unique - 1) / 2 / (1ULL << PARTIAL_KEY_BITS)
+	);
+
+	free(keys.records);
+
+	TEST_ASSERT_GREATER_THAN(150000, unique);
+	TEST_ASSERT_EQUAL(0, collisions);
+
+	// Every bit is set in 50% +- 1% of the keys
+	TEST_ASSERT_LESS_THAN(unique / 100, worst_bit);
+
+	// Zobrist keys of related positions are linearly dependent, so the
+	// chi-square spreads wider than for independent samples. Within 10% of
+	// the degrees of freedom is still a uniform index.
+	TEST_ASSERT_LESS_THAN(1.1 * (INDEX_BUCKETS_NB - 1), chi_square);
+	TEST_ASSERT_GREATER_THAN(0.9 * (INDEX_BUCKETS_NB - 1), chi_square);
+
+	TEST_ASSERT_LESS_THAN(2 * partial_expected, partial);
+	TEST_ASSERT_GREATER_THAN(partial_expected / 2, partial);
+}
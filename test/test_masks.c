@@ -8,6 +8,8 @@
 void test_masks_init(void)
 {
 	init_rays();
+	init_patterns();
+	init_slider_attacks();
 }
 
 void test_pawn_move_mask(void)
@@ -190,3 +192,42 @@ void test_queen_attacks_mask(void)
 		0x302ULL, queen_attacks_mask(SQ_A1, 0x303ULL)
 	);
 }
+
+void test_slider_attacks_tables(void)
+{
+	U64 random_state = 0x9E3779B97F4A7C15ULL;
+
+	for(Square sq = SQ_A1; sq < SQ_NB; sq++) {
+		TEST_ASSERT_EQUAL_UINT64(
+			rook_ray_attacks_mask(sq, EMPTY),
+			rook_attacks_mask(sq, EMPTY)
+		);
+
+		TEST_ASSERT_EQUAL_UINT64(
+			bishop_ray_attacks_mask(sq, EMPTY),
+			bishop_attacks_mask(sq, EMPTY)
+		);
+
+		for(uint32_t i = 0; i < 1000; i++) {
+			random_state ^= random_state >> 12;
+			random_state ^= random_state << 25;
+			random_state ^= random_state >> 27;
+
+			// Sparse and dense occupancies
+			U64 occupied = random_state * 0x2545F4914F6CDD1DULL;
+
+			if(i & 1)
+				occupied &= occupied >> 7;
+
+			TEST_ASSERT_EQUAL_UINT64(
+				rook_ray_attacks_mask(sq, occupied),
+				rook_attacks_mask(sq, occupied)
+			);
+
+			TEST_ASSERT_EQUAL_UINT64(
+				bishop_ray_attacks_mask(sq, occupied),
+				bishop_attacks_mask(sq, occupied)
+			);
+		}
+	}
+}
@@ -9,6 +9,8 @@
 #include "patterns.h"
 #include "masks.h"
 #include "perft.h"
+#include "hash.h"
+#include "tree_walk.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -17,6 +19,25 @@
 void test_init(void)
 {
 	init_rays();
+	init_patterns();
+	init_slider_attacks();
+	init_hash_keys();
+}
+
+/// Check info returned by check_info()
+static CheckInfo test_check_info;
+
+/**
+ * \brief Returns the check info of the position with the check ray replaced
+ * by the given one
+ */
+static const CheckInfo *check_info(const Position *pos, U64 check_ray)
+{
+	init_check_info(pos, &test_check_info);
+
+	test_check_info.check_ray = check_ray;
+
+	return &test_check_info;
 }
 
 void test_init_move_list(void)
@@ -35,17 +56,7 @@ void test_ml_add(void)
 	MoveList *move_list = init_move_list();
 
 	ExtMove move = {
-		.move = {
-			.move_type = COMMON,
-
-			.moved_piece_type = PAWN,
-			.promotion_piece_type = NO_PIECE_TYPE,
-
-			.color = WHITE,
-
-			.source = SQ_E4,
-			.destination = SQ_E5,
-		},
+		.move = make_move(SQ_E4, SQ_E5, COMMON, NO_PIECE_TYPE),
 
 		.eval = NO_EVAL,
 	};
@@ -82,17 +93,7 @@ void test_ml_remove(void)
 	MoveList *move_list = init_move_list();
 
 	ExtMove move = {
-		.move = {
-			.move_type = COMMON,
-
-			.moved_piece_type = PAWN,
-			.promotion_piece_type = NO_PIECE_TYPE,
-
-			.color = WHITE,
-
-			.source = SQ_E4,
-			.destination = SQ_E5,
-		},
+		.move = make_move(SQ_E4, SQ_E5, COMMON, NO_PIECE_TYPE),
 
 		.eval = NO_EVAL,
 	};
@@ -117,33 +118,13 @@ void test_ml_pop(void)
 	MoveList *move_list = init_move_list();
 
 	ExtMove move_1 = {
-		.move = {
-			.move_type = COMMON,
-
-			.moved_piece_type = PAWN,
-			.promotion_piece_type = NO_PIECE_TYPE,
-
-			.color = WHITE,
-
-			.source = SQ_E4,
-			.destination = SQ_E5,
-		},
+		.move = make_move(SQ_E4, SQ_E5, COMMON, NO_PIECE_TYPE),
 
 		.eval = NO_EVAL,
 	};
 
 	ExtMove move_2 = {
-		.move = {
-			.move_type = COMMON,
-
-			.moved_piece_type = ROOK,
-			.promotion_piece_type = NO_PIECE_TYPE,
-
-			.color = BLACK,
-
-			.source = SQ_E6,
-			.destination = SQ_E5,
-		},
+		.move = make_move(SQ_E6, SQ_E5, COMMON, NO_PIECE_TYPE),
 
 		.eval = NO_EVAL,
 	};
@@ -166,58 +147,26 @@ void test_add_common_moves(void)
 {
 	MoveList *move_list = init_move_list();
 
-	add_common_moves(move_list, W_PAWN, SQ_E2, 0x10100000ULL);
-	add_common_moves(move_list, W_KNIGHT, SQ_G1, 0xA00000ULL);
-	add_common_moves(move_list, W_KNIGHT, SQ_B1, 0x50000ULL);
-	add_common_moves(move_list, W_PAWN, SQ_D2, 0x8080000ULL);
+	add_common_moves(move_list, SQ_E2, 0x10100000ULL);
+	add_common_moves(move_list, SQ_G1, 0xA00000ULL);
+	add_common_moves(move_list, SQ_B1, 0x50000ULL);
+	add_common_moves(move_list, SQ_D2, 0x8080000ULL);
 
-	Move move_1 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E2, .destination = SQ_E3
-	};
+	Move move_1 = make_move(SQ_E2, SQ_E3, COMMON, NO_PIECE_TYPE);
 
-	Move move_2 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E2, .destination = SQ_E4
-	};
+	Move move_2 = make_move(SQ_E2, SQ_E4, COMMON, NO_PIECE_TYPE);
 
-	Move move_3 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_G1, .destination = SQ_F3
-	};
+	Move move_3 = make_move(SQ_G1, SQ_F3, COMMON, NO_PIECE_TYPE);
 
-	Move move_4 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_G1, .destination = SQ_H3
-	};
+	Move move_4 = make_move(SQ_G1, SQ_H3, COMMON, NO_PIECE_TYPE);
 
-	Move move_5 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_B1, .destination = SQ_A3
-	};
+	Move move_5 = make_move(SQ_B1, SQ_A3, COMMON, NO_PIECE_TYPE);
 
-	Move move_6 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_B1, .destination = SQ_C3
-	};
+	Move move_6 = make_move(SQ_B1, SQ_C3, COMMON, NO_PIECE_TYPE);
 
-	Move move_7 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_D2, .destination = SQ_D3
-	};
+	Move move_7 = make_move(SQ_D2, SQ_D3, COMMON, NO_PIECE_TYPE);
 
-	Move move_8 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_D2, .destination = SQ_D4
-	};
+	Move move_8 = make_move(SQ_D2, SQ_D4, COMMON, NO_PIECE_TYPE);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -238,29 +187,13 @@ void test_add_castlings(void)
 	add_castlings(move_list, SQ_E1, 0x44ULL);
 	add_castlings(move_list, SQ_E8, 0x4400000000000000ULL);
 	
-	Move move_1 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_C1
-	};
+	Move move_1 = make_move(SQ_E1, SQ_C1, CASTLING, NO_PIECE_TYPE);
 
-	Move move_2 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_G1
-	};
+	Move move_2 = make_move(SQ_E1, SQ_G1, CASTLING, NO_PIECE_TYPE);
 
-	Move move_3 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_C8
-	};
+	Move move_3 = make_move(SQ_E8, SQ_C8, CASTLING, NO_PIECE_TYPE);
 
-	Move move_4 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_G8
-	};
+	Move move_4 = make_move(SQ_E8, SQ_G8, CASTLING, NO_PIECE_TYPE);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -274,56 +207,24 @@ void test_add_promotions(void)
 {
 	MoveList *move_list = init_move_list();
 
-	add_promotions(move_list, WHITE, SQ_B7, 0x200000000000000ULL);
-	add_promotions(move_list, BLACK, SQ_H2, 0x80ULL);
+	add_promotions(move_list, SQ_B7, 0x200000000000000ULL);
+	add_promotions(move_list, SQ_H2, 0x80ULL);
 
-	Move move_1 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = KNIGHT, .color = WHITE,
-		.source = SQ_B7, .destination = SQ_B8
-	};
+	Move move_1 = make_move(SQ_B7, SQ_B8, PROMOTION, KNIGHT);
 
-	Move move_2 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = BISHOP, .color = WHITE,
-		.source = SQ_B7, .destination = SQ_B8
-	};
+	Move move_2 = make_move(SQ_B7, SQ_B8, PROMOTION, BISHOP);
 
-	Move move_3 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = ROOK, .color = WHITE,
-		.source = SQ_B7, .destination = SQ_B8
-	};
+	Move move_3 = make_move(SQ_B7, SQ_B8, PROMOTION, ROOK);
 
-	Move move_4 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = WHITE,
-		.source = SQ_B7, .destination = SQ_B8
-	};
+	Move move_4 = make_move(SQ_B7, SQ_B8, PROMOTION, QUEEN);
 
-	Move move_5 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = KNIGHT, .color = BLACK,
-		.source = SQ_H2, .destination = SQ_H1
-	};
+	Move move_5 = make_move(SQ_H2, SQ_H1, PROMOTION, KNIGHT);
 
-	Move move_6 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = BISHOP, .color = BLACK,
-		.source = SQ_H2, .destination = SQ_H1
-	};
+	Move move_6 = make_move(SQ_H2, SQ_H1, PROMOTION, BISHOP);
 
-	Move move_7 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = ROOK, .color = BLACK,
-		.source = SQ_H2, .destination = SQ_H1
-	};
+	Move move_7 = make_move(SQ_H2, SQ_H1, PROMOTION, ROOK);
 
-	Move move_8 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = BLACK,
-		.source = SQ_H2, .destination = SQ_H1
-	};
+	Move move_8 = make_move(SQ_H2, SQ_H1, PROMOTION, QUEEN);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -341,35 +242,19 @@ void test_add_en_passant(void)
 {
 	MoveList *move_list = init_move_list();
 
-	add_en_passant(move_list, WHITE, 0x2000ULL, SQ_G3);
-	add_en_passant(move_list, WHITE, 0x2000ULL, SQ_E3);
+	add_en_passant(move_list, 0x2000ULL, SQ_G3);
+	add_en_passant(move_list, 0x2000ULL, SQ_E3);
 
-	add_en_passant(move_list, BLACK, 0x80000000000ULL, SQ_C5);
-	add_en_passant(move_list, BLACK, 0x80000000000ULL, SQ_E5);
+	add_en_passant(move_list, 0x80000000000ULL, SQ_C5);
+	add_en_passant(move_list, 0x80000000000ULL, SQ_E5);
 
-	Move move_1 = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_F2, .destination = SQ_G3
-	};
+	Move move_1 = make_move(SQ_F2, SQ_G3, EN_PASSANT, NO_PIECE_TYPE);
 
-	Move move_2 = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_F2, .destination = SQ_E3
-	};
+	Move move_2 = make_move(SQ_F2, SQ_E3, EN_PASSANT, NO_PIECE_TYPE);
 
-	Move move_3 = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_D6, .destination = SQ_C5
-	};
+	Move move_3 = make_move(SQ_D6, SQ_C5, EN_PASSANT, NO_PIECE_TYPE);
 
-	Move move_4 = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_D6, .destination = SQ_E5
-	};
+	Move move_4 = make_move(SQ_D6, SQ_E5, EN_PASSANT, NO_PIECE_TYPE);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -397,17 +282,12 @@ void test_king_safe_moves_mask(void)
 	TEST_ASSERT_EQUAL_UINT64(0x30200000000ULL, king_safe_moves_mask(pos_4, SQ_A5, BLACK));
 	TEST_ASSERT_EQUAL_UINT64(0x00ULL, king_safe_moves_mask(pos_5, SQ_A1, WHITE));
 
-	free(pos_1->state);
-	free(pos_2->state);
-	free(pos_3->state);
-	free(pos_4->state);
-	free(pos_5->state);
-
-	free(pos_1);
-	free(pos_2);
-	free(pos_3);
-	free(pos_4);
-	free(pos_5);
+
+	free_position(pos_1);
+	free_position(pos_2);
+	free_position(pos_3);
+	free_position(pos_4);
+	free_position(pos_5);
 }
 
 void test_possible_castlings(void)
@@ -429,17 +309,12 @@ void test_possible_castlings(void)
 	TEST_ASSERT_EQUAL_UINT32(WHITE_OOO, possible_castlings(pos_5, WHITE));
 	TEST_ASSERT_EQUAL_UINT32(NO_CASTLING, possible_castlings(pos_5, BLACK));
 
-	free(pos_1->state);
-	free(pos_2->state);
-	free(pos_3->state);
-	free(pos_4->state);
-	free(pos_5->state);
-
-	free(pos_1);
-	free(pos_2);
-	free(pos_3);
-	free(pos_4);
-	free(pos_5);
+
+	free_position(pos_1);
+	free_position(pos_2);
+	free_position(pos_3);
+	free_position(pos_4);
+	free_position(pos_5);
 }
 
 void test_generate_castlings(void)
@@ -450,19 +325,11 @@ void test_generate_castlings(void)
 
 	MoveList *move_list = init_move_list();
 
-	Move move_1 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_C1
-	};
+	Move move_1 = make_move(SQ_E1, SQ_C1, CASTLING, NO_PIECE_TYPE);
 
-	Move move_2 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_G8
-	};
+	Move move_2 = make_move(SQ_E8, SQ_G8, CASTLING, NO_PIECE_TYPE);
 
-	pos_1->state->previous_move.color = BLACK;
+	pos_1->state->turn = WHITE;
 	generate_castlings(pos_1, move_list);
 
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
@@ -470,7 +337,7 @@ void test_generate_castlings(void)
 	free(move_list);
 	move_list = init_move_list();
 
-	pos_1->state->previous_move.color = WHITE;
+	pos_1->state->turn = BLACK;
 	generate_castlings(pos_1, move_list);
 
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
@@ -478,7 +345,7 @@ void test_generate_castlings(void)
 	free(move_list);
 	move_list = init_move_list();
 
-	pos_2->state->previous_move.color = BLACK;
+	pos_2->state->turn = WHITE;
 	generate_castlings(pos_2, move_list);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
@@ -486,7 +353,7 @@ void test_generate_castlings(void)
 	free(move_list);
 	move_list = init_move_list();
 	
-	pos_2->state->previous_move.color = WHITE;
+	pos_2->state->turn = BLACK;
 	generate_castlings(pos_2, move_list);
 
 	// TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[0], sizeof(move_1));
@@ -494,7 +361,7 @@ void test_generate_castlings(void)
 	free(move_list);
 	move_list = init_move_list();
 	
-	pos_3->state->previous_move.color = BLACK;
+	pos_3->state->turn = WHITE;
 	generate_castlings(pos_3, move_list);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
@@ -502,52 +369,102 @@ void test_generate_castlings(void)
 	free(move_list);
 	move_list = init_move_list();
 	
-	pos_3->state->previous_move.color = WHITE;
+	pos_3->state->turn = BLACK;
 	generate_castlings(pos_3, move_list);
 
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
 
 	free(move_list);
 
-	free(pos_1->state);
-	free(pos_2->state);
-	free(pos_3->state);
 
-	free(pos_1);
-	free(pos_2);
-	free(pos_3);
+	free_position(pos_1);
+	free_position(pos_2);
+	free_position(pos_3);
+}
+
+void test_init_check_info(void)
+{
+	Position *pos = init_position(
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+	);
+
+	CheckInfo check_info;
+
+	init_check_info(pos, &check_info);
+
+	TEST_ASSERT_EQUAL(SQ_E1, check_info.king_square);
+	TEST_ASSERT_EQUAL_UINT64(EMPTY, check_info.checkers);
+	TEST_ASSERT_EQUAL_UINT64(UNIVERSE, check_info.check_ray);
+	TEST_ASSERT_EQUAL_UINT64(EMPTY, check_info.pinned);
+	TEST_ASSERT_EQUAL_UINT64(
+		0x2838000000000000ULL, check_info.check_squares[QUEEN]
+	);
+
+	free_position(pos);
+
+	// The knight gives check, the bishop pins the pawn
+	pos = init_position("3k4/8/8/7b/3n4/5P2/3QK3/5B2 w - - 0 1");
+
+	init_check_info(pos, &check_info);
+
+	TEST_ASSERT_EQUAL(SQ_E2, check_info.king_square);
+	TEST_ASSERT_EQUAL_UINT64(0x8000000ULL, check_info.checkers);
+	TEST_ASSERT_EQUAL_UINT64(0x8000000ULL, check_info.check_ray);
+	TEST_ASSERT_EQUAL_UINT64(0x200000ULL, check_info.pinned);
+	TEST_ASSERT_EQUAL_UINT64(0x8040200000ULL, pin_ray(&check_info, SQ_F3));
+	TEST_ASSERT_EQUAL_UINT64(UNIVERSE, pin_ray(&check_info, SQ_D2));
+
+	TEST_ASSERT_EQUAL_UINT64(
+		0x14000000000000ULL, check_info.check_squares[PAWN]
+	);
+	TEST_ASSERT_EQUAL_UINT64(
+		0x22140000000000ULL, check_info.check_squares[KNIGHT]
+	);
+	TEST_ASSERT_EQUAL_UINT64(
+		check_info.check_squares[BISHOP] | check_info.check_squares[ROOK],
+		check_info.check_squares[QUEEN]
+	);
+	TEST_ASSERT_EQUAL_UINT64(EMPTY, check_info.check_squares[KING]);
+
+	free_position(pos);
+
+	// Double check
+	pos = init_position("4k3/8/8/8/7b/8/2n5/R3K3 w - - 0 1");
+
+	init_check_info(pos, &check_info);
+
+	TEST_ASSERT_EQUAL_UINT64(0x80000400ULL, check_info.checkers);
+	TEST_ASSERT_EQUAL_UINT64(EMPTY, check_info.check_ray);
+
+	free_position(pos);
 }
 
 void test_filter_legal_moves(void)
 {
 	Position *pos = init_position("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 
-	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, SQ_E1, 0x3828ULL, UNIVERSE));
-	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, SQ_D1, 0x00ULL, UNIVERSE));
+	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, check_info(pos, UNIVERSE), SQ_E1, 0x3828ULL));
+	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, check_info(pos, UNIVERSE), SQ_D1, 0x00ULL));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 	
 	pos = init_position("1k6/8/8/7B/7b/8/2n5/R3K3 w - - 0 1");
-	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, SQ_A1, 0x10101010101010EULL, EMPTY));
-	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, SQ_H5, 0x1020400040201008ULL, EMPTY));
+	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, check_info(pos, EMPTY), SQ_A1, 0x10101010101010EULL));
+	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, check_info(pos, EMPTY), SQ_H5, 0x1020400040201008ULL));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("1k6/8/8/8/7b/R7/8/R3K3 w - - 0 1");	
-	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, SQ_A1, 0x10EULL, 0x80402000ULL));
-	TEST_ASSERT_EQUAL_UINT64(0x400000ULL, filter_legal_moves(pos, SQ_A3, 0x101010101FE0100ULL, 0x80402000ULL));
+	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, check_info(pos, 0x80402000ULL), SQ_A1, 0x10EULL));
+	TEST_ASSERT_EQUAL_UINT64(0x400000ULL, filter_legal_moves(pos, check_info(pos, 0x80402000ULL), SQ_A3, 0x101010101FE0100ULL));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("3k4/8/8/7b/3n4/5P2/3QK3/5B2 w - - 0 1");
-	TEST_ASSERT_EQUAL_UINT64(0x8000000ULL, filter_legal_moves(pos, SQ_D2, 0x8080708ULL, 0x8000000ULL));
-	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, SQ_F3, 0x20000000ULL, 0x8000000ULL));
+	TEST_ASSERT_EQUAL_UINT64(0x8000000ULL, filter_legal_moves(pos, check_info(pos, 0x8000000ULL), SQ_D2, 0x8080708ULL));
+	TEST_ASSERT_EQUAL_UINT64(0x00ULL, filter_legal_moves(pos, check_info(pos, 0x8000000ULL), SQ_F3, 0x20000000ULL));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_generate_knight_moves(void)
@@ -555,31 +472,15 @@ void test_generate_knight_moves(void)
 	Position *pos = init_position("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 	MoveList *move_list = init_move_list();
 
-	Move move_1 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_B1, .destination = SQ_A3
-	};
+	Move move_1 = make_move(SQ_B1, SQ_A3, COMMON, NO_PIECE_TYPE);
 
-	Move move_2 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_B1, .destination = SQ_C3
-	};
+	Move move_2 = make_move(SQ_B1, SQ_C3, COMMON, NO_PIECE_TYPE);
 
-	Move move_3 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_G1, .destination = SQ_F3
-	};
+	Move move_3 = make_move(SQ_G1, SQ_F3, COMMON, NO_PIECE_TYPE);
 
-	Move move_4 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_G1, .destination = SQ_H3
-	};
+	Move move_4 = make_move(SQ_G1, SQ_H3, COMMON, NO_PIECE_TYPE);
 
-	generate_knight_moves(move_list, pos, UNIVERSE);
+	generate_knight_moves(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -589,34 +490,18 @@ void test_generate_knight_moves(void)
 
 	do_move(pos, move_1);
 
-	move_1 = (Move){
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_B8, .destination = SQ_A6
-	};
+	move_1 = make_move(SQ_B8, SQ_A6, COMMON, NO_PIECE_TYPE);
 
-	move_2 = (Move){
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_B8, .destination = SQ_C6
-	};
+	move_2 = make_move(SQ_B8, SQ_C6, COMMON, NO_PIECE_TYPE);
 
-	move_3 = (Move){
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_G8, .destination = SQ_F6
-	};
+	move_3 = make_move(SQ_G8, SQ_F6, COMMON, NO_PIECE_TYPE);
 
-	move_4 = (Move){
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_G8, .destination = SQ_H6
-	};
+	move_4 = make_move(SQ_G8, SQ_H6, COMMON, NO_PIECE_TYPE);
 
 	free(move_list);
 	move_list = init_move_list();
 
-	generate_knight_moves(move_list, pos, UNIVERSE);
+	generate_knight_moves(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -625,26 +510,20 @@ void test_generate_knight_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(4, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("8/7k/8/5b2/8/8/1N6/1KN4r w - - 0 1");
 	move_list = init_move_list();
 
-	move_1 = (Move){
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_B2, .destination = SQ_D3
-	};
+	move_1 = make_move(SQ_B2, SQ_D3, COMMON, NO_PIECE_TYPE);
 
-	generate_knight_moves(move_list, pos, 0x2010080400);
+	generate_knight_moves(move_list, pos, check_info(pos, 0x2010080400), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_UINT32(1, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_generate_pawn_moves(void)
@@ -653,31 +532,15 @@ void test_generate_pawn_moves(void)
 	Position *pos = init_position("4k3/6P1/5K2/8/8/8/8/8 w - - 0 1");
 	MoveList *move_list = init_move_list();
 
-	Move move_1 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = KNIGHT, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_1 = make_move(SQ_G7, SQ_G8, PROMOTION, KNIGHT);
 
-	Move move_2 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = BISHOP, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_2 = make_move(SQ_G7, SQ_G8, PROMOTION, BISHOP);
 
-	Move move_3 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = ROOK, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_3 = make_move(SQ_G7, SQ_G8, PROMOTION, ROOK);
 
-	Move move_4 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_4 = make_move(SQ_G7, SQ_G8, PROMOTION, QUEEN);
 
-	generate_pawn_moves(move_list, pos, UNIVERSE);
+	generate_pawn_moves(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -686,61 +549,28 @@ void test_generate_pawn_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(4, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("2k2r2/6P1/4K3/8/8/8/8/8 w - - 0 1");
 	move_list = init_move_list();
 
-	move_1 = (Move){
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = KNIGHT, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_F8
-	};
+	move_1 = make_move(SQ_G7, SQ_F8, PROMOTION, KNIGHT);
 
-	move_2 = (Move){
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = BISHOP, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_F8
-	};
+	move_2 = make_move(SQ_G7, SQ_F8, PROMOTION, BISHOP);
 
-	move_3 = (Move){
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = ROOK, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_F8
-	};
+	move_3 = make_move(SQ_G7, SQ_F8, PROMOTION, ROOK);
 
-	move_4 = (Move){
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_F8
-	};
+	move_4 = make_move(SQ_G7, SQ_F8, PROMOTION, QUEEN);
 
-	Move move_5 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = KNIGHT, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_5 = make_move(SQ_G7, SQ_G8, PROMOTION, KNIGHT);
 
-	Move move_6 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = BISHOP, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_6 = make_move(SQ_G7, SQ_G8, PROMOTION, BISHOP);
 
-	Move move_7 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = ROOK, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_7 = make_move(SQ_G7, SQ_G8, PROMOTION, ROOK);
 
-	Move move_8 = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = WHITE,
-		.source = SQ_G7, .destination = SQ_G8
-	};
+	Move move_8 = make_move(SQ_G7, SQ_G8, PROMOTION, QUEEN);
 
-	generate_pawn_moves(move_list, pos, UNIVERSE);
+	generate_pawn_moves(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_MEMORY(&move_2, &move_list->move_list[1], sizeof(move_2));
@@ -753,49 +583,41 @@ void test_generate_pawn_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(8, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for common moves
 	pos = init_position("2k1r3/1p6/8/8/8/6P1/4KP2/2B5 w - - 0 1");
 	move_list = init_move_list();
 
-	generate_pawn_moves(move_list, pos, 0x1010101010100000ULL);
+	generate_pawn_moves(move_list, pos, check_info(pos, 0x1010101010100000ULL), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("2kr4/8/7q/8/p7/3P4/3KP3/8 w - - 0 1");
 	move_list = init_move_list();
 
-	generate_pawn_moves(move_list, pos, 0x804020100000ULL);
+	generate_pawn_moves(move_list, pos, check_info(pos, 0x804020100000ULL), GEN_ALL);
 
-	move_1 = (Move){
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E2, .destination = SQ_E3
-	};
+	move_1 = make_move(SQ_E2, SQ_E3, COMMON, NO_PIECE_TYPE);
 
 	TEST_ASSERT_EQUAL_MEMORY(&move_1, &move_list->move_list[0], sizeof(move_1));
 	TEST_ASSERT_EQUAL_UINT32(1, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("2kr4/8/7q/8/p7/3P4/3KP2r/8 w - - 0 1");
 	move_list = init_move_list();
 
-	generate_pawn_moves(move_list, pos, 0x804020100000ULL);
+	generate_pawn_moves(move_list, pos, check_info(pos, 0x804020100000ULL), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbqkbnr/pppp1ppp/8/3PpP2/8/8/PPP1P1PP/RNBQKBNR w KQkq e6 0 1"
@@ -803,13 +625,12 @@ void test_generate_pawn_moves(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_moves(move_list, pos, UNIVERSE);
+	generate_pawn_moves(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_UINT32(16, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"k7/2K2rb1/8/4pP2/8/8/8/8 w - e6 0 1"
@@ -819,14 +640,13 @@ void test_generate_pawn_moves(void)
 
 	PositionState state = *pos->state;
 
-	generate_pawn_moves(move_list, pos, 0x38000000000000ULL);
+	generate_pawn_moves(move_list, pos, check_info(pos, 0x38000000000000ULL), GEN_ALL);
 
 	TEST_ASSERT_EQUAL_MEMORY(&state, pos->state, sizeof(PositionState));
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_generate_pawn_promotions(void)
@@ -837,13 +657,12 @@ void test_generate_pawn_promotions(void)
 
 	MoveList *move_list = init_move_list();
 
-	generate_pawn_promotions(move_list, pos, UNIVERSE, pieces(pos, W_PAWN));
+	generate_pawn_promotions(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, W_PAWN));
 
 	TEST_ASSERT_EQUAL(0, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/1K2P3/8/8/8/8/8/k7 w - - 0 1"
@@ -851,31 +670,34 @@ void test_generate_pawn_promotions(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_promotions(move_list, pos, UNIVERSE, pieces(pos, W_PAWN));
+	generate_pawn_promotions(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, W_PAWN));
 
 	TEST_ASSERT_EQUAL(4, ml_len(move_list));
 
 	while(ml_len(move_list)) {
 		Move move = ml_pop(move_list).move;
 
-		TEST_ASSERT_EQUAL(SQ_E8, move.destination);
-		TEST_ASSERT_EQUAL(SQ_E7, move.source);
+		TEST_ASSERT_EQUAL(SQ_E8, destination_of_move(move));
+		TEST_ASSERT_EQUAL(SQ_E7, source_of_move(move));
 
-		TEST_ASSERT_EQUAL(PROMOTION, move.move_type);
+		TEST_ASSERT_EQUAL(PROMOTION, type_of_move(move));
 
-		TEST_ASSERT_EQUAL(WHITE, move.color);
+		TEST_ASSERT_EQUAL(
+			WHITE, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 
 		TEST_ASSERT_NOT_EQUAL(
 			NO_PIECE_TYPE,
-			move.promotion_piece_type
+			promotion_of_move(move)
 		);
 
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/8/6K1/8/8/8/3p4/k3N2R b - - 0 1"
@@ -883,7 +705,7 @@ void test_generate_pawn_promotions(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_promotions(move_list, pos, UNIVERSE, pieces(pos, B_PAWN));
+	generate_pawn_promotions(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, B_PAWN));
 
 	TEST_ASSERT_EQUAL(8, ml_len(move_list));
 
@@ -891,29 +713,53 @@ void test_generate_pawn_promotions(void)
 		Move move = ml_pop(move_list).move;
 
 		TEST_ASSERT_TRUE(
-			square_to_bitboard(move.destination)
+			square_to_bitboard(destination_of_move(move))
 			& (
 				square_to_bitboard(SQ_D1)
 				| square_to_bitboard(SQ_E1)
 			)
 		);
-		TEST_ASSERT_EQUAL(SQ_D2, move.source);
+		TEST_ASSERT_EQUAL(SQ_D2, source_of_move(move));
 
-		TEST_ASSERT_EQUAL(PROMOTION, move.move_type);
+		TEST_ASSERT_EQUAL(PROMOTION, type_of_move(move));
 
-		TEST_ASSERT_EQUAL(BLACK, move.color);
+		TEST_ASSERT_EQUAL(
+			BLACK, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 
 		TEST_ASSERT_NOT_EQUAL(
 			NO_PIECE_TYPE,
-			move.promotion_piece_type
+			promotion_of_move(move)
 		);
 
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+
+	// The pinned pawn may only take the pinner
+	pos = init_position(
+		"5b1n/6P1/7K/8/8/8/8/k7 w - - 0 1"
+	);
+
+	move_list = init_move_list();
+
+	generate_pawn_promotions(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, W_PAWN));
+
+	TEST_ASSERT_EQUAL(4, ml_len(move_list));
+
+	while(ml_len(move_list)) {
+		Move move = ml_pop(move_list).move;
+
+		TEST_ASSERT_EQUAL(SQ_G7, source_of_move(move));
+		TEST_ASSERT_EQUAL(SQ_F8, destination_of_move(move));
+	}
+
+	free(move_list);
+	free_position(pos);
 }
 
 void test_generate_sliding_pieces(void)
@@ -927,7 +773,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		QUEEN,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		queen_attacks_mask
 	);
 
@@ -935,7 +782,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		ROOK,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		rook_attacks_mask
 	);
 
@@ -943,14 +791,14 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		BISHOP,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		bishop_attacks_mask
 	);
 
 	TEST_ASSERT_EQUAL_UINT32(0, ml_len(move_list));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 	free(move_list);
 
 	pos = init_position(
@@ -962,7 +810,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		QUEEN,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		queen_attacks_mask
 	);
 
@@ -970,7 +819,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		ROOK,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		rook_attacks_mask
 	);
 
@@ -978,14 +828,14 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		BISHOP,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		bishop_attacks_mask
 	);
 
 	TEST_ASSERT_EQUAL_UINT32(25, ml_len(move_list));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 	free(move_list);
 
 	pos = init_position(
@@ -997,7 +847,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		QUEEN,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		queen_attacks_mask
 	);
 
@@ -1005,7 +856,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		ROOK,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		rook_attacks_mask
 	);
 
@@ -1013,14 +865,14 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		BISHOP,
-		UNIVERSE,
+		check_info(pos, UNIVERSE),
+		GEN_ALL,
 		bishop_attacks_mask
 	);
 
 	TEST_ASSERT_EQUAL_UINT32(21, ml_len(move_list));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 	free(move_list);
 
 	pos = init_position(
@@ -1032,7 +884,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		QUEEN,
-		0x1010101010100000,
+		check_info(pos, 0x1010101010100000),
+		GEN_ALL,
 		queen_attacks_mask
 	);
 
@@ -1040,7 +893,8 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		ROOK,
-		0x1010101010100000,
+		check_info(pos, 0x1010101010100000),
+		GEN_ALL,
 		rook_attacks_mask
 	);
 
@@ -1048,14 +902,14 @@ void test_generate_sliding_pieces(void)
 		move_list,
 		pos,
 		BISHOP,
-		0x1010101010100000,
+		check_info(pos, 0x1010101010100000),
+		GEN_ALL,
 		bishop_attacks_mask
 	);
 
 	TEST_ASSERT_EQUAL_UINT32(3, ml_len(move_list));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 	free(move_list);
 }
 
@@ -1067,13 +921,12 @@ void test_generate_pawn_common(void)
 
 	MoveList *move_list = init_move_list();
 
-	generate_pawn_common(move_list, pos, UNIVERSE, pieces(pos, W_PAWN));
+	generate_pawn_common(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, W_PAWN));
 
 	TEST_ASSERT_EQUAL(16, ml_len(move_list));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rkr5/ppp3P1/8/8/8/2P5/P2PPP2/RNBQKBNR w KQq - 0 1"
@@ -1081,31 +934,34 @@ void test_generate_pawn_common(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_common(move_list, pos, UNIVERSE, 0x43900ULL);
+	generate_pawn_common(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, 0x43900ULL);
 
 	TEST_ASSERT_EQUAL(9, ml_len(move_list));
 
 	while(ml_len(move_list)) {
 		Move move = ml_pop(move_list).move;
 
-		TEST_ASSERT_NOT_EQUAL(SQ_NONE, move.destination);
-		TEST_ASSERT_NOT_EQUAL(SQ_NONE, move.source);
+		TEST_ASSERT_NOT_EQUAL(SQ_NONE, destination_of_move(move));
+		TEST_ASSERT_NOT_EQUAL(SQ_NONE, source_of_move(move));
 
-		TEST_ASSERT_EQUAL(COMMON, move.move_type);
+		TEST_ASSERT_EQUAL(COMMON, type_of_move(move));
 
-		TEST_ASSERT_EQUAL(WHITE, move.color);
+		TEST_ASSERT_EQUAL(
+			WHITE, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 
 		TEST_ASSERT_EQUAL(
 			NO_PIECE_TYPE,
-			move.promotion_piece_type
+			promotion_of_move(move)
 		);
 
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"1k6/2p5/2p5/2pP4/3P4/3P4/8/4K3 b - - 0 1"
@@ -1113,28 +969,31 @@ void test_generate_pawn_common(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_common(move_list, pos, UNIVERSE, pieces(pos, B_PAWN));
+	generate_pawn_common(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, B_PAWN));
 
 	TEST_ASSERT_EQUAL(3, ml_len(move_list));
 
 	while(ml_len(move_list)) {
 		Move move = ml_pop(move_list).move;
 
-		TEST_ASSERT_EQUAL(COMMON, move.move_type);
+		TEST_ASSERT_EQUAL(COMMON, type_of_move(move));
 
-		TEST_ASSERT_EQUAL(BLACK, move.color);
+		TEST_ASSERT_EQUAL(
+			BLACK, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 
 		TEST_ASSERT_EQUAL(
 			NO_PIECE_TYPE,
-			move.promotion_piece_type
+			promotion_of_move(move)
 		);
 
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"5k2/8/8/8/1p6/8/1PK1P2r/8 w - - 0 1"
@@ -1142,28 +1001,31 @@ void test_generate_pawn_common(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_common(move_list, pos, UNIVERSE, pieces(pos, W_PAWN));
+	generate_pawn_common(move_list, pos, check_info(pos, UNIVERSE), GEN_ALL, pieces(pos, W_PAWN));
 
 	TEST_ASSERT_EQUAL(1, ml_len(move_list));
 
 	while(ml_len(move_list)) {
 		Move move = ml_pop(move_list).move;
 
-		TEST_ASSERT_EQUAL(COMMON, move.move_type);
+		TEST_ASSERT_EQUAL(COMMON, type_of_move(move));
 
-		TEST_ASSERT_EQUAL(WHITE, move.color);
+		TEST_ASSERT_EQUAL(
+			WHITE, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 
 		TEST_ASSERT_EQUAL(
 			NO_PIECE_TYPE,
-			move.promotion_piece_type
+			promotion_of_move(move)
 		);
 
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	free(move_list);	
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_generate_pawn_en_passant(void)
@@ -1179,28 +1041,31 @@ void test_generate_pawn_en_passant(void)
 
 	MoveList *move_list = init_move_list();
 
-	generate_pawn_en_passant(move_list, pos, UNIVERSE);
+	generate_pawn_en_passant(move_list, pos, check_info(pos, UNIVERSE));
 
 	TEST_ASSERT_EQUAL(2, ml_len(move_list));
 
 	while(ml_len(move_list)) {
 		Move move = ml_pop(move_list).move;
 
-		TEST_ASSERT_EQUAL(SQ_E6, move.destination);
+		TEST_ASSERT_EQUAL(SQ_E6, destination_of_move(move));
 
-		TEST_ASSERT_EQUAL(EN_PASSANT, move.move_type);
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
-		TEST_ASSERT_EQUAL(NO_PIECE_TYPE, move.promotion_piece_type);
+		TEST_ASSERT_EQUAL(EN_PASSANT, type_of_move(move));
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
+		TEST_ASSERT_EQUAL(NO_PIECE_TYPE, promotion_of_move(move));
 
-		TEST_ASSERT_EQUAL(WHITE, move.color);
+		TEST_ASSERT_EQUAL(
+			WHITE, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	TEST_ASSERT_EQUAL_MEMORY(&board, &pos->board, sizeof(Board));
 	TEST_ASSERT_EQUAL_MEMORY(&state, pos->state, sizeof(PositionState));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/4R3/8/8/4pPp1/6K1/8/4k3 b - f3 0 1"
@@ -1212,29 +1077,32 @@ void test_generate_pawn_en_passant(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_en_passant(move_list, pos, UNIVERSE);
+	generate_pawn_en_passant(move_list, pos, check_info(pos, UNIVERSE));
 
 	TEST_ASSERT_EQUAL(1, ml_len(move_list));
 
 	while(ml_len(move_list)) {
 		Move move = ml_pop(move_list).move;
 
-		TEST_ASSERT_EQUAL(SQ_F3, move.destination);
-		TEST_ASSERT_EQUAL(SQ_G4, move.source);
+		TEST_ASSERT_EQUAL(SQ_F3, destination_of_move(move));
+		TEST_ASSERT_EQUAL(SQ_G4, source_of_move(move));
 
-		TEST_ASSERT_EQUAL(EN_PASSANT, move.move_type);
-		TEST_ASSERT_EQUAL(PAWN, move.moved_piece_type);
-		TEST_ASSERT_EQUAL(NO_PIECE_TYPE, move.promotion_piece_type);
+		TEST_ASSERT_EQUAL(EN_PASSANT, type_of_move(move));
+		TEST_ASSERT_EQUAL(
+			PAWN, type_of_piece(piece_on(pos, source_of_move(move)))
+		);
+		TEST_ASSERT_EQUAL(NO_PIECE_TYPE, promotion_of_move(move));
 
-		TEST_ASSERT_EQUAL(BLACK, move.color);
+		TEST_ASSERT_EQUAL(
+			BLACK, color_of_piece(piece_on(pos, source_of_move(move)))
+		);
 	}
 
 	TEST_ASSERT_EQUAL_MEMORY(&board, &pos->board, sizeof(Board));
 	TEST_ASSERT_EQUAL_MEMORY(&state, pos->state, sizeof(PositionState));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/4b3/1k6/1Pp5/8/K7/8/8 b - c6 0 1"
@@ -1246,7 +1114,7 @@ void test_generate_pawn_en_passant(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_en_passant(move_list, pos, UNIVERSE);
+	generate_pawn_en_passant(move_list, pos, check_info(pos, UNIVERSE));
 
 	TEST_ASSERT_EQUAL(0, ml_len(move_list));
 
@@ -1254,8 +1122,7 @@ void test_generate_pawn_en_passant(void)
 	TEST_ASSERT_EQUAL_MEMORY(&state, pos->state, sizeof(PositionState));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/8/8/pP4k1/8/4K3/8/3n2b1 b - a6 0 1"
@@ -1267,7 +1134,7 @@ void test_generate_pawn_en_passant(void)
 
 	move_list = init_move_list();
 
-	generate_pawn_en_passant(move_list, pos, EMPTY);
+	generate_pawn_en_passant(move_list, pos, check_info(pos, EMPTY));
 
 	TEST_ASSERT_EQUAL(0, ml_len(move_list));
 
@@ -1275,8 +1142,57 @@ void test_generate_pawn_en_passant(void)
 	TEST_ASSERT_EQUAL_MEMORY(&state, pos->state, sizeof(PositionState));
 
 	free(move_list);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+
+	// The pawn which made the double push gives check and is captured
+	pos = init_position(
+		"8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1"
+	);
+
+	move_list = init_move_list();
+
+	generate_pawn_en_passant(move_list, pos, check_info(pos, square_to_bitboard(SQ_D4)));
+
+	TEST_ASSERT_EQUAL(1, ml_len(move_list));
+	TEST_ASSERT_EQUAL(
+		make_move(SQ_E4, SQ_D3, EN_PASSANT, NO_PIECE_TYPE),
+		ml_pop(move_list).move
+	);
+
+	free(move_list);
+	free_position(pos);
+
+	// Double check by the pawn and a knight
+	pos = init_position(
+		"8/8/8/2k5/3Pp3/1N6/8/4K3 b - d3 0 1"
+	);
+
+	move_list = init_move_list();
+
+	generate_pawn_en_passant(move_list, pos, check_info(pos, UNIVERSE));
+
+	TEST_ASSERT_EQUAL(0, ml_len(move_list));
+
+	free(move_list);
+	free_position(pos);
+
+	// Only the second capturing pawn is pinned
+	pos = init_position(
+		"8/8/2B5/8/2pPp3/5k2/8/4K3 b - d3 0 1"
+	);
+
+	move_list = init_move_list();
+
+	generate_pawn_en_passant(move_list, pos, check_info(pos, UNIVERSE));
+
+	TEST_ASSERT_EQUAL(1, ml_len(move_list));
+	TEST_ASSERT_EQUAL(
+		make_move(SQ_C4, SQ_D3, EN_PASSANT, NO_PIECE_TYPE),
+		ml_pop(move_list).move
+	);
+
+	free(move_list);
+	free_position(pos);
 }
 
 void test_generate_all_moves(void)
@@ -1290,8 +1206,7 @@ void test_generate_all_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(8902, perft(pos, 3));
 	TEST_ASSERT_EQUAL_UINT32(197281, perft(pos, 4));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
@@ -1302,8 +1217,7 @@ void test_generate_all_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(97862, perft(pos, 3));
 	TEST_ASSERT_EQUAL_UINT32(4085603, perft(pos, 4));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -"
@@ -1313,9 +1227,9 @@ void test_generate_all_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(191, perft(pos, 2));
 	TEST_ASSERT_EQUAL_UINT32(2812, perft(pos, 3));
 	TEST_ASSERT_EQUAL_UINT32(43238, perft(pos, 4));
+	TEST_ASSERT_EQUAL_UINT32(674624, perft(pos, 5));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1"
@@ -1326,8 +1240,7 @@ void test_generate_all_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(9467, perft(pos, 3));
 	TEST_ASSERT_EQUAL_UINT32(422333, perft(pos, 4));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"
@@ -1338,8 +1251,7 @@ void test_generate_all_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(62379, perft(pos, 3));
 	TEST_ASSERT_EQUAL_UINT32(2103487, perft(pos, 4));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"
@@ -1349,6 +1261,312 @@ void test_generate_all_moves(void)
 	TEST_ASSERT_EQUAL_UINT32(2079, perft(pos, 2));
 	TEST_ASSERT_EQUAL_UINT32(89890, perft(pos, 3));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+}
+
+void test_generate_moves(void)
+{
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	MoveList move_list;
+
+	// Garbage left from the previous node must be discarded
+	move_list.last = move_list.move_list + 10;
+
+	TEST_ASSERT_EQUAL(&move_list, generate_moves(pos, &move_list));
+	TEST_ASSERT_EQUAL(48, ml_len(&move_list));
+
+	MoveList *all_moves = generate_all_moves(pos);
+
+	TEST_ASSERT_EQUAL(ml_len(all_moves), ml_len(&move_list));
+
+	for (int i = 0; i < ml_len(all_moves); i++) {
+		TEST_ASSERT_EQUAL(
+			all_moves->move_list[i].move, move_list.move_list[i].move
+		);
+	}
+
+	free(all_moves);
+
+	generate_moves(pos, &move_list);
+
+	TEST_ASSERT_EQUAL(48, ml_len(&move_list));
+
+	free_position(pos);
+}
+
+/// Positions with castlings, promotions, en passant and checks
+static const char *gen_type_fens[] = {
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+	"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+	"8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"3k4/8/8/7b/3n4/5P2/3QK3/5B2 w - - 0 1",
+};
+
+/**
+ * \brief Returns true if the move is in the list
+ */
+static bool ml_contains(const MoveList *move_list, Move move)
+{
+	for (const ExtMove *ext = move_list->move_list; ext < move_list->last; ext++) {
+		if (ext->move == move)
+			return true;
+	}
+
+	return false;
+}
+
+void test_generate_captures_and_quiets(void)
+{
+	for (size_t i = 0; i < sizeof(gen_type_fens) / sizeof(char *); i++) {
+		Position *pos = init_position(gen_type_fens[i]);
+
+		MoveList all_moves, captures, quiets;
+
+		generate_moves(pos, &all_moves);
+
+		ml_clear(&captures);
+		ml_clear(&quiets);
+
+		CheckInfo check_info;
+
+		init_check_info(pos, &check_info);
+
+		TEST_ASSERT_EQUAL(
+			&captures, generate_captures(pos, &check_info, &captures)
+		);
+		TEST_ASSERT_EQUAL(
+			&quiets, generate_quiets(pos, &check_info, &quiets)
+		);
+
+		// Both lists together are exactly the legal moves
+		TEST_ASSERT_EQUAL(
+			ml_len(&all_moves), ml_len(&captures) + ml_len(&quiets)
+		);
+
+		for (ExtMove *ext = captures.move_list; ext < captures.last; ext++) {
+			Move move = ext->move;
+
+			TEST_ASSERT_TRUE(ml_contains(&all_moves, move));
+			TEST_ASSERT_TRUE(
+				piece_on(pos, destination_of_move(move)) != NO_PIECE
+				|| type_of_move(move) == EN_PASSANT
+				|| promotion_of_move(move) == QUEEN
+			);
+		}
+
+		for (ExtMove *ext = quiets.move_list; ext < quiets.last; ext++) {
+			Move move = ext->move;
+
+			TEST_ASSERT_TRUE(ml_contains(&all_moves, move));
+			TEST_ASSERT_FALSE(ml_contains(&captures, move));
+		}
+
+		// The lists are appended to
+		generate_captures(pos, &check_info, &quiets);
+
+		TEST_ASSERT_EQUAL(ml_len(&all_moves), ml_len(&quiets));
+
+		free_position(pos);
+	}
+}
+
+void test_is_valid_move(void)
+{
+	for (size_t i = 0; i < sizeof(gen_type_fens) / sizeof(char *); i++) {
+		Position *pos = init_position(gen_type_fens[i]);
+
+		MoveList move_list;
+		CheckInfo check_info;
+
+		generate_moves(pos, &move_list);
+		init_check_info(pos, &check_info);
+
+		for (ExtMove *ext = move_list.move_list; ext < move_list.last; ext++)
+			TEST_ASSERT_TRUE(is_valid_move(pos, &check_info, ext->move));
+
+		// Every other move between two squares is rejected
+		for (Square src = SQ_A1; src < SQ_NB; src++) {
+			for (Square dst = SQ_A1; dst < SQ_NB; dst++) {
+				Move move = make_move(src, dst, COMMON, NO_PIECE_TYPE);
+
+				TEST_ASSERT_EQUAL(
+					ml_contains(&move_list, move),
+					is_valid_move(pos, &check_info, move)
+				);
+			}
+		}
+
+		free_position(pos);
+	}
+
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	CheckInfo check_info;
+
+	init_check_info(pos, &check_info);
+
+	TEST_ASSERT_FALSE(is_valid_move(pos, &check_info, MOVE_NONE));
+	TEST_ASSERT_FALSE(is_valid_move(pos, &check_info, MOVE_NULL));
+
+	// A move of the wrong type
+	TEST_ASSERT_FALSE(is_valid_move(
+		pos, &check_info, make_move(SQ_E1, SQ_G1, COMMON, NO_PIECE_TYPE)
+	));
+	TEST_ASSERT_TRUE(is_valid_move(
+		pos, &check_info, make_move(SQ_E1, SQ_G1, CASTLING, NO_PIECE_TYPE)
+	));
+
+	// A move of the side which isn't to move
+	TEST_ASSERT_FALSE(is_valid_move(
+		pos, &check_info, make_move(SQ_A6, SQ_B5, COMMON, NO_PIECE_TYPE)
+	));
+
+	free_position(pos);
+}
+
+/**
+ * \brief Checks that the pseudo-legal moves which pass is_legal() are exactly
+ * the legal moves, #NodeCallback of test_generate_pseudo_legal()
+ */
+static void check_pseudo_legal(Position *pos, void *data)
+{
+	MoveList legal_moves, pseudo_legal;
+	CheckInfo check_info;
+
+	(void)data;
+
+	TEST_ASSERT_NOT_NULL(generate_moves(pos, &legal_moves));
+
+	init_check_info(pos, &check_info);
+	ml_clear(&pseudo_legal);
+
+	generate_pseudo_legal(pos, &check_info, &pseudo_legal, GEN_CAPTURES);
+	generate_pseudo_legal(pos, &check_info, &pseudo_legal, GEN_QUIETS);
+
+	TEST_ASSERT_TRUE(ml_len(&pseudo_legal) >= ml_len(&legal_moves));
+
+	uint32_t count = 0;
+
+	for (ExtMove *ext = pseudo_legal.move_list; ext < pseudo_legal.last; ext++) {
+		bool legal = is_legal(pos, &check_info, ext->move);
+
+		TEST_ASSERT_EQUAL(legal, ml_contains(&legal_moves, ext->move));
+
+		count += legal;
+	}
+
+	TEST_ASSERT_EQUAL(ml_len(&legal_moves), count);
+}
+
+void test_generate_pseudo_legal(void)
+{
+	for (size_t i = 0; i < sizeof(gen_type_fens) / sizeof(char *); i++) {
+		Position *pos = init_position(gen_type_fens[i]);
+
+		walk_tree(pos, 2, check_pseudo_legal, NULL);
+
+		free_position(pos);
+	}
+
+	// Pinned pieces and king moves along the checking ray
+	Position *pos = init_position("4k3/4r3/8/8/1b6/8/3N4/r3K2R w K - 0 1");
+
+	walk_tree(pos, 1, check_pseudo_legal, NULL);
+
+	free_position(pos);
+}
+
+/**
+ * \brief Checks count_legal_moves() against #generate_moves, #NodeCallback of
+ * test_count_legal_moves()
+ */
+static void check_count_legal_moves(Position *pos, void *data)
+{
+	MoveList move_list;
+
+	(void)data;
+
+	TEST_ASSERT_NOT_NULL(generate_moves(pos, &move_list));
+	TEST_ASSERT_EQUAL(ml_len(&move_list), count_legal_moves(pos));
+}
+
+void test_count_legal_moves(void)
+{
+	const char *fens[] = {
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+		"5b1n/6P1/7K/8/8/8/8/k7 w - - 0 1",
+	};
+
+	for (size_t i = 0; i < sizeof(fens) / sizeof(*fens); i++) {
+		Position *pos = init_position(fens[i]);
+
+		walk_tree(pos, 3, check_count_legal_moves, NULL);
+
+		free_position(pos);
+	}
+}
+
+void test_perft_parallel(void)
+{
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	U64 key = pos->state->key;
+
+	TEST_ASSERT_EQUAL_UINT64(97862, perft_parallel(pos, 3, 4));
+	TEST_ASSERT_EQUAL_UINT64(4085603, perft_parallel(pos, 4, 3));
+
+	// The root position is left as it was
+	TEST_ASSERT_EQUAL_UINT64(key, pos->state->key);
+	TEST_ASSERT_EQUAL(pos->state_history, pos->state);
+
+	free_position(pos);
+
+	// Checkmated side has no subtrees at all
+	pos = init_position("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+
+	TEST_ASSERT_EQUAL_UINT64(0, perft_parallel(pos, 3, 2));
+
+	free_position(pos);
+}
+
+void test_perft_table(void)
+{
+	TEST_ASSERT_TRUE(perft_table_resize(4));
+
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	// The second run is answered from the table
+	TEST_ASSERT_EQUAL_UINT64(4085603, perft(pos, 4));
+	TEST_ASSERT_EQUAL_UINT64(4085603, perft(pos, 4));
+	TEST_ASSERT_EQUAL_UINT64(97862, perft(pos, 3));
+	TEST_ASSERT_EQUAL_UINT64(4085603, perft_parallel(pos, 4, 3));
+
+	free_position(pos);
+
+	// Same positions at other depths aren't mixed up
+	pos = init_position("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -");
+
+	for (int depth = 1; depth <= 5; depth++) {
+		const U64 expected[] = {0, 14, 191, 2812, 43238, 674624};
+
+		TEST_ASSERT_EQUAL_UINT64(expected[depth], perft(pos, depth));
+	}
+
+	free_position(pos);
+
+	perft_table_free();
 }
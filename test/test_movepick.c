@@ -0,0 +1,167 @@
+#include "unity.h"
+#include "bitboard.h"
+#include "bitboard_mapping.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "movepick.h"
+#include "position.h"
+#include "piece.h"
+#include "patterns.h"
+#include "masks.h"
+#include "rays.h"
+
+#include <stdlib.h>
+
+// Initializing everything needed for tests
+void test_init(void)
+{
+	init_rays();
+	init_patterns();
+	init_slider_attacks();
+}
+
+// Quiet moves are ordered by generation without history scores
+static Evaluation history[12][64];
+
+static const char *picker_fens[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - -",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"4k3/8/8/8/8/8/4r3/4K3 w - - 0 1",
+};
+
+/**
+ * \brief Collects all the legal moves of the picker into the list
+ */
+static void pick_all(MovePicker *picker, Move *moves, uint32_t *count)
+{
+	Move move;
+
+	*count = 0;
+
+	while ((move = next_move(picker)) != MOVE_NONE) {
+		TEST_ASSERT_LESS_THAN(256, *count);
+
+		if (is_legal(picker->pos, &picker->check_info, move))
+			moves[(*count)++] = move;
+	}
+
+	// The picker stays done
+	TEST_ASSERT_EQUAL(MOVE_NONE, next_move(picker));
+}
+
+static uint32_t index_of(const Move *moves, uint32_t count, Move move)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		if (moves[i] == move)
+			return i;
+	}
+
+	return count;
+}
+
+void test_next_move_returns_all_moves(void)
+{
+	for (size_t i = 0; i < sizeof(picker_fens) / sizeof(*picker_fens); i++) {
+		Position *pos = init_position(picker_fens[i]);
+
+		MoveList all;
+		MoveList storage;
+		MovePicker picker;
+
+		Move moves[256];
+		uint32_t count;
+
+		generate_moves(pos, &all);
+
+		init_move_picker(
+			&picker, pos, &storage, MOVE_NONE, MOVE_NONE, MOVE_NONE,
+			history
+		);
+		pick_all(&picker, moves, &count);
+
+		TEST_ASSERT_EQUAL(ml_len(&all), count);
+
+		// Every legal move exactly once
+		for (ExtMove *ext = all.move_list; ext < all.last; ext++) {
+			uint32_t index = index_of(moves, count, ext->move);
+
+			TEST_ASSERT_LESS_THAN(count, index);
+			TEST_ASSERT_EQUAL(
+				count,
+				index_of(
+					moves + index + 1, count - index - 1,
+					ext->move
+				) + index + 1
+			);
+		}
+
+		free_position(pos);
+	}
+}
+
+void test_next_move_order(void)
+{
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	MoveList storage;
+	MovePicker picker;
+
+	Move moves[256];
+	uint32_t count;
+
+	Move hash_move = make_move(SQ_A2, SQ_A3, COMMON, 0);
+	Move killer = make_move(SQ_E1, SQ_G1, CASTLING, 0);
+	Move capture = make_move(SQ_E2, SQ_A6, COMMON, 0);
+
+	// A capture as a killer is returned among the captures
+	init_move_picker(
+		&picker, pos, &storage, hash_move, killer, capture, history
+	);
+	pick_all(&picker, moves, &count);
+
+	TEST_ASSERT_EQUAL(48, count);
+
+	TEST_ASSERT_EQUAL(hash_move, moves[0]);
+	TEST_ASSERT_EQUAL(count - 1, index_of(moves + 1, count - 1, hash_move));
+
+	uint32_t killer_index = index_of(moves, count, killer);
+	uint32_t capture_index = index_of(moves, count, capture);
+
+	TEST_ASSERT_LESS_THAN(killer_index, capture_index);
+
+	// Killers go right after the good captures
+	for (uint32_t i = 1; i < killer_index; i++) {
+		TEST_ASSERT_NOT_EQUAL(
+			NO_PIECE, piece_on(pos, destination_of_move(moves[i]))
+		);
+	}
+
+	// Qf3xf6 loses the queen for a knight and goes after the quiet moves
+	uint32_t bad_index = index_of(
+		moves, count, make_move(SQ_F3, SQ_F6, COMMON, 0)
+	);
+
+	for (uint32_t i = killer_index; i < count; i++) {
+		if (piece_on(pos, destination_of_move(moves[i])) == NO_PIECE)
+			TEST_ASSERT_LESS_THAN(bad_index, i);
+	}
+
+	// Illegal hash move and killers are dropped
+	init_move_picker(
+		&picker, pos, &storage,
+		make_move(SQ_A2, SQ_A5, COMMON, 0),
+		make_move(SQ_H1, SQ_H8, COMMON, 0),
+		MOVE_NULL,
+		history
+	);
+	pick_all(&picker, moves, &count);
+
+	TEST_ASSERT_EQUAL(48, count);
+
+	free_position(pos);
+}
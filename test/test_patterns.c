@@ -9,6 +9,7 @@
 void test_patterns_init(void)
 {
 	init_rays();
+	init_patterns();
 }
 
 void test_pawn_move_pattern(void)
@@ -147,3 +148,20 @@ void test_queen_move_pattern(void)
 		0x24A870DF70A82422ULL, queen_move_pattern(SQ_F5)
 	);
 }
+
+void test_init_patterns(void)
+{
+	init_patterns();
+
+	for(Square sq = SQ_A1; sq < SQ_NB; sq++) {
+		TEST_ASSERT_EQUAL_UINT64(knight_move_pattern(sq), knight_attacks[sq]);
+		TEST_ASSERT_EQUAL_UINT64(king_move_pattern(sq), king_attacks[sq]);
+
+		TEST_ASSERT_EQUAL_UINT64(
+			white_pawn_attack_pattern(sq), pawn_attacks[WHITE][sq]
+		);
+		TEST_ASSERT_EQUAL_UINT64(
+			black_pawn_attack_pattern(sq), pawn_attacks[BLACK][sq]
+		);
+	}
+}
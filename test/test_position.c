@@ -6,6 +6,9 @@
 #include "patterns.h"
 #include "masks.h"
 #include "position.h"
+#include "movegen.h"
+#include "hash.h"
+#include "tree_walk.h"
 
 #include <stdlib.h>
 
@@ -13,6 +16,9 @@
 void test_init(void)
 {
 	init_rays();
+	init_patterns();
+	init_slider_attacks();
+	init_hash_keys();
 }
 
 void test_init_position(void)
@@ -40,33 +46,32 @@ void test_init_position(void)
 		0x8002000000000000ULL, pos->board.BlackBishops
 	);
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pos->board.BlackKing);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("this is not valid FEN");
 
 	TEST_ASSERT_NULL(pos);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("2q5/8/8/8/8/8/8/6Q1 w - - 0 1");
 
 	TEST_ASSERT_NULL(pos);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("1k6/8/8/2PP4/2P1P3/5Q2/8/8 w - - 0 1");
 
 	TEST_ASSERT_NULL(pos);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("1k6/8/8/6K1/8/8/8/P5p1 w - - 0 1");
 
 	TEST_ASSERT_NULL(pos);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("1k3pp1/8/8/6K1/8/8/8/8 w - - 0 1");
 
 	TEST_ASSERT_NULL(pos);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
@@ -91,8 +96,40 @@ void test_init_position(void)
 	TEST_ASSERT_EQUAL_UINT64(0x800000000000000ULL, pos->board.BlackQueens);
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pos->board.BlackKing);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+}
+
+void test_make_move(void)
+{
+	TEST_ASSERT_EQUAL(2, sizeof(Move));
+
+	Move move = make_move(SQ_E2, SQ_E4, COMMON, NO_PIECE_TYPE);
+
+	TEST_ASSERT_EQUAL(SQ_E2, source_of_move(move));
+	TEST_ASSERT_EQUAL(SQ_E4, destination_of_move(move));
+	TEST_ASSERT_EQUAL(COMMON, type_of_move(move));
+	TEST_ASSERT_EQUAL(NO_PIECE_TYPE, promotion_of_move(move));
+
+	move = make_move(SQ_H2, SQ_G1, PROMOTION, QUEEN);
+
+	TEST_ASSERT_EQUAL(SQ_H2, source_of_move(move));
+	TEST_ASSERT_EQUAL(SQ_G1, destination_of_move(move));
+	TEST_ASSERT_EQUAL(PROMOTION, type_of_move(move));
+	TEST_ASSERT_EQUAL(QUEEN, promotion_of_move(move));
+
+	for (PieceType pt = KNIGHT; pt <= QUEEN; pt++) {
+		move = make_move(SQ_A7, SQ_A8, PROMOTION, pt);
+
+		TEST_ASSERT_EQUAL(pt, promotion_of_move(move));
+	}
+
+	move = make_move(SQ_E8, SQ_C8, CASTLING, NO_PIECE_TYPE);
+
+	TEST_ASSERT_EQUAL(CASTLING, type_of_move(move));
+	TEST_ASSERT_EQUAL(SQ_C8, destination_of_move(move));
+
+	TEST_ASSERT_NOT_EQUAL(MOVE_NONE, make_move(SQ_A1, SQ_A2, COMMON, NO_PIECE_TYPE));
+	TEST_ASSERT_NOT_EQUAL(MOVE_NULL, MOVE_NONE);
 }
 
 void test_pieces(void)
@@ -115,8 +152,7 @@ void test_pieces(void)
 	);
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pieces(pos, B_KING));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
@@ -135,8 +171,7 @@ void test_pieces(void)
 	TEST_ASSERT_EQUAL_UINT64(0x800000000000000ULL, pieces(pos, B_QUEEN));
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pieces(pos, B_KING));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_set_piece(void)
@@ -164,8 +199,7 @@ void test_set_piece(void)
 	TEST_ASSERT_EQUAL_UINT64(0x100ULL, pos->board.BlackQueens);
 	TEST_ASSERT_EQUAL_UINT64(0x8000000000ULL, pos->board.WhiteKnights);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_remove_piece(void)
@@ -193,8 +227,7 @@ void test_remove_piece(void)
 	);
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pos->board.BlackKing);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_move_piece(void)
@@ -222,8 +255,7 @@ void test_move_piece(void)
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pos->board.BlackKing);
 	TEST_ASSERT_EQUAL_UINT64(0x10000ULL, pos->board.WhitePawns);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_piece_on(void)
@@ -239,9 +271,62 @@ void test_piece_on(void)
 	TEST_ASSERT_EQUAL(B_PAWN, piece_on(pos, SQ_A7));
 	TEST_ASSERT_EQUAL(B_ROOK, piece_on(pos, SQ_A8));
 	TEST_ASSERT_EQUAL(B_QUEEN, piece_on(pos, SQ_D8));
+	TEST_ASSERT_EQUAL(NO_PIECE, piece_on(pos, SQ_E4));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+}
+
+/**
+ * \brief Checks that the mailbox and the occupancy bitboards agree with the
+ * piece bitboards, #NodeCallback of test_board_squares()
+ */
+static void check_board_squares(Position *pos, void *data)
+{
+	(void)data;
+
+	U64 occupied_by[COLOR_NB] = {EMPTY, EMPTY};
+
+	for (Square sq = SQ_A1; sq < SQ_NB; sq++) {
+		Piece piece = NO_PIECE;
+
+		for (uint32_t i = 0; i < 12; i++) {
+			if (pos->board.pieces[i] & square_to_bitboard(sq)) {
+				piece = make_piece(i / 6, i % 6 + 1);
+				occupied_by[i / 6] |= square_to_bitboard(sq);
+			}
+		}
+
+		TEST_ASSERT_EQUAL(piece, pos->board_squares[sq]);
+	}
+
+	const Color color = pos->state->turn;
+
+	TEST_ASSERT_EQUAL_UINT64(occupied_by[WHITE], pos->occupied_by[WHITE]);
+	TEST_ASSERT_EQUAL_UINT64(occupied_by[BLACK], pos->occupied_by[BLACK]);
+
+	TEST_ASSERT_EQUAL_UINT64(occupied_by[color], pos->state->allies);
+	TEST_ASSERT_EQUAL_UINT64(occupied_by[!color], pos->state->enemies);
+	TEST_ASSERT_EQUAL_UINT64(
+		occupied_by[WHITE] | occupied_by[BLACK], pos->state->occupied
+	);
+}
+
+void test_board_squares(void)
+{
+	// Castlings, promotions with captures and en passant
+	const char *fens[] = {
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+		"8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",
+	};
+
+	for (uint32_t i = 0; i < 3; i++) {
+		Position *pos = init_position(fens[i]);
+
+		walk_tree(pos, 3, check_board_squares, NULL);
+
+		free_position(pos);
+	}
 }
 
 void test_attaked_by(void)
@@ -258,8 +343,84 @@ void test_attaked_by(void)
 		0x1000000000ULL, attacked_by(pos, SQ_D6, WHITE)
 	);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+}
+
+void test_copy_position(void)
+{
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	do_move(pos, make_move(SQ_E2, SQ_A6, COMMON, NO_PIECE_TYPE));
+
+	Position *copy = copy_position(pos);
+
+	TEST_ASSERT_NOT_NULL(copy);
+	TEST_ASSERT_EQUAL(copy->state_history + 1, copy->state);
+	TEST_ASSERT_EQUAL_UINT64(pos->state->key, copy->state->key);
+
+	// Moves on the copy don't touch the original
+	do_move(copy, make_move(SQ_B4, SQ_C3, COMMON, NO_PIECE_TYPE));
+
+	TEST_ASSERT_EQUAL(B_PAWN, piece_on(copy, SQ_C3));
+	TEST_ASSERT_EQUAL(W_KNIGHT, piece_on(pos, SQ_C3));
+
+	undo_move(copy);
+	undo_move(copy);
+	undo_move(pos);
+
+	TEST_ASSERT_EQUAL_UINT64(pos->state->key, copy->state->key);
+	TEST_ASSERT_EQUAL_MEMORY(&pos->board, &copy->board, sizeof(Board));
+
+	free_position(copy);
+	free_position(pos);
+}
+
+void test_attacked_squares(void)
+{
+	const char *fens[] = {
+		"8/6b1/3p4/r1r1K3/8/5n2/4q3/k7 w - - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+		"NN4NN/8/8/3K4/8/8/8/NN2k1NN w - - 0 1",
+	};
+
+	for (size_t i = 0; i < sizeof(fens) / sizeof(*fens); i++) {
+		Position *pos = init_position(fens[i]);
+
+		for (Color color = WHITE; color < COLOR_NB; color++) {
+			U64 expected = EMPTY;
+
+			for (Square sq = SQ_A1; sq < SQ_NB; sq++) {
+				if (attacked_by(pos, sq, color))
+					expected |= square_to_bitboard(sq);
+			}
+
+			TEST_ASSERT_EQUAL_UINT64(
+				expected,
+				attacked_squares(pos, color, pos->state->occupied)
+			);
+		}
+
+		free_position(pos);
+	}
+
+	// Without the king the rook attacks the squares behind it
+	Position *pos = init_position("8/8/8/8/r3K3/8/8/k7 w - - 0 1");
+
+	U64 occupied = pos->state->occupied ^ square_to_bitboard(SQ_E4);
+
+	TEST_ASSERT_TRUE(
+		attacked_squares(pos, BLACK, occupied)
+		& square_to_bitboard(SQ_F4)
+	);
+	TEST_ASSERT_FALSE(
+		attacked_squares(pos, BLACK, pos->state->occupied)
+		& square_to_bitboard(SQ_F4)
+	);
+
+	free_position(pos);
 }
 
 void test_do_null_move(void)
@@ -278,8 +439,7 @@ void test_do_null_move(void)
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 	TEST_ASSERT_EQUAL_UINT32(0, pos->state->move_50_rule);
 	
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbk1b1r/ppp1pppp/5n2/3p4/3P4/4P3/PPP2PPP/RNB1KBNR b KQ - 0 1"
@@ -295,8 +455,7 @@ void test_do_null_move(void)
 	TEST_ASSERT_EQUAL_UINT32(ALL_WHITE, pos->state->castling);
 	TEST_ASSERT_EQUAL_UINT32(0, pos->state->move_50_rule);
 	
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_undo_null_move(void)
@@ -325,8 +484,7 @@ void test_undo_null_move(void)
 		0x8002000000000000ULL, pos->board.BlackBishops
 	);
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pos->board.BlackKing);
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
@@ -352,8 +510,7 @@ void test_undo_null_move(void)
 	TEST_ASSERT_EQUAL_UINT64(0x800000000000000ULL, pos->board.BlackQueens);
 	TEST_ASSERT_EQUAL_UINT64(0x1000000000000000ULL, pos->board.BlackKing);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_do_move(void)
@@ -362,13 +519,10 @@ void test_do_move(void)
 		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 	);
 
-	Move move = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E2, .destination = SQ_E4
-	};
+	Move move = make_move(SQ_E2, SQ_E4, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move);
 
+	TEST_ASSERT_EQUAL_UINT32(SQ_E3, pos->state->en_passant);
 	TEST_ASSERT_EQUAL_UINT64(0xFFFF00001000EFFF, pos->state->occupied);
 	TEST_ASSERT_EQUAL_UINT64(0xFFFF000000000000, pos->state->allies);
 	TEST_ASSERT_EQUAL_UINT64(0x1000EFFF, pos->state->enemies);
@@ -378,11 +532,7 @@ void test_do_move(void)
 	TEST_ASSERT_EQUAL_UINT32(0, pos->state->move_50_rule);
 
 
-	Move move_2 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E7, .destination = SQ_E5
-	};
+	Move move_2 = make_move(SQ_E7, SQ_E5, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_2);
 
 	TEST_ASSERT_EQUAL_UINT64(0xFFEF00101000EFFF, pos->state->occupied);
@@ -393,11 +543,7 @@ void test_do_move(void)
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 	TEST_ASSERT_EQUAL_UINT32(0, pos->state->move_50_rule);
 
-	Move move_3 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_G1, .destination = SQ_F3
-	};
+	Move move_3 = make_move(SQ_G1, SQ_F3, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_3);
 
 	TEST_ASSERT_EQUAL_UINT64(0xFFEF00101020EFBF, pos->state->occupied);
@@ -408,11 +554,7 @@ void test_do_move(void)
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 	TEST_ASSERT_EQUAL_UINT32(1, pos->state->move_50_rule);
 
-	Move move_4 = {
-		.move_type = COMMON, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_E7
-	};
+	Move move_4 = make_move(SQ_E8, SQ_E7, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_4);
 
 	TEST_ASSERT_EQUAL_UINT64(0xEFFF00101020EFBF, pos->state->occupied);
@@ -423,11 +565,7 @@ void test_do_move(void)
 	TEST_ASSERT_EQUAL_UINT32(ALL_WHITE, pos->state->castling);
 	TEST_ASSERT_EQUAL_UINT32(2, pos->state->move_50_rule);
 
-	Move move_5 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_F3, .destination = SQ_E5
-	};
+	Move move_5 = make_move(SQ_F3, SQ_E5, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_5);
 
 	TEST_ASSERT_EQUAL_UINT64(0xEFFF00101000EFBF, pos->state->occupied);
@@ -439,33 +577,28 @@ void test_do_move(void)
 	TEST_ASSERT_EQUAL_UINT32(0, pos->state->move_50_rule);
 
 	// Tests for previous_state
-	TEST_ASSERT_EQUAL_UINT64(0xEFFF00101020EFBF, pos->state->previous_state->occupied);
-	TEST_ASSERT_EQUAL_UINT64(0x1020EFBF, pos->state->previous_state->allies);
-	TEST_ASSERT_EQUAL_UINT64(0xEFFF001000000000, pos->state->previous_state->enemies);
+	TEST_ASSERT_EQUAL_UINT64(0xEFFF00101020EFBF, (pos->state - 1)->occupied);
+	TEST_ASSERT_EQUAL_UINT64(0x1020EFBF, (pos->state - 1)->allies);
+	TEST_ASSERT_EQUAL_UINT64(0xEFFF001000000000, (pos->state - 1)->enemies);
 
-	TEST_ASSERT_EQUAL_UINT32(NO_PIECE, pos->state->previous_state->captured_piece);
-	TEST_ASSERT_EQUAL_UINT32(ALL_WHITE, pos->state->previous_state->castling);
-	TEST_ASSERT_EQUAL_UINT32(2, pos->state->previous_state->move_50_rule);
+	TEST_ASSERT_EQUAL_UINT32(NO_PIECE, (pos->state - 1)->captured_piece);
+	TEST_ASSERT_EQUAL_UINT32(ALL_WHITE, (pos->state - 1)->castling);
+	TEST_ASSERT_EQUAL_UINT32(2, (pos->state - 1)->move_50_rule);
 
 	// Tests for previous_move
-	TEST_ASSERT_EQUAL_UINT32(COMMON, pos->state->previous_move.move_type);
-	TEST_ASSERT_EQUAL_UINT32(KNIGHT, pos->state->previous_move.moved_piece_type);
-	TEST_ASSERT_EQUAL_UINT32(NO_PIECE_TYPE, pos->state->previous_move.promotion_piece_type);
-	TEST_ASSERT_EQUAL_UINT32(WHITE, pos->state->previous_move.color);
-	TEST_ASSERT_EQUAL_UINT32(SQ_F3, pos->state->previous_move.source);
-	TEST_ASSERT_EQUAL_UINT32(SQ_E5, pos->state->previous_move.destination);
+	TEST_ASSERT_EQUAL_UINT32(
+		make_move(SQ_F3, SQ_E5, COMMON, NO_PIECE_TYPE),
+		pos->state->previous_move
+	);
+	TEST_ASSERT_EQUAL_UINT32(BLACK, pos->state->turn);
+	TEST_ASSERT_EQUAL_UINT32(SQ_NONE, pos->state->en_passant);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for promotion
 	pos = init_position("8/7P/k7/8/8/8/K7/8 w - - 0 1");
 
-	Move move_promotion = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = WHITE,
-		.source = SQ_H7, .destination = SQ_H8
-	};
+	Move move_promotion = make_move(SQ_H7, SQ_H8, PROMOTION, QUEEN);
 	do_move(pos, move_promotion);
 
 	TEST_ASSERT_EQUAL_UINT64(0x8000010000000100, pos->state->occupied);
@@ -486,17 +619,14 @@ void test_do_move(void)
 	TEST_ASSERT_EQUAL_UINT64(0x10000000000ULL, pos->board.BlackKing);
 	TEST_ASSERT_EQUAL_UINT64(0x8000000000000000ULL, pos->board.WhiteQueens);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for castling
 	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R w KQkq - 0 1");
 
-	Move move_castling_white_00 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_G1
-	};
+	Move move_castling_white_00 = make_move(
+		SQ_E1, SQ_G1, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_white_00);
 
 	TEST_ASSERT_EQUAL_UINT64(0x91F700000000F761, pos->state->occupied);
@@ -519,16 +649,13 @@ void test_do_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_BLACK, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R w KQkq - 0 1");
 
-	Move move_castling_white_000 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_C1
-	};
+	Move move_castling_white_000 = make_move(
+		SQ_E1, SQ_C1, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_white_000);
 
 	TEST_ASSERT_EQUAL_UINT64(0x91F700000000F78c, pos->state->occupied);
@@ -551,16 +678,13 @@ void test_do_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_BLACK, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
-	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R w KQkq - 0 1");
+	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R b KQkq - 0 1");
 
-	Move move_castling_black_00 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_G8
-	};
+	Move move_castling_black_00 = make_move(
+		SQ_E8, SQ_G8, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_black_00);
 
 	TEST_ASSERT_EQUAL_UINT64(0x61F700000000F791, pos->state->occupied);
@@ -583,16 +707,13 @@ void test_do_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_WHITE, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
-	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R w KQkq - 0 1");
+	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R b KQkq - 0 1");
 
-	Move move_castling_black_000 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_C8
-	};
+	Move move_castling_black_000 = make_move(
+		SQ_E8, SQ_C8, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_black_000);
 
 	TEST_ASSERT_EQUAL_UINT64(0x8CF700000000F791, pos->state->occupied);
@@ -615,17 +736,14 @@ void test_do_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_WHITE, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for en passant
-	pos = init_position("1k5r/8/8/8/5pP1/2P5/3P4/1K6 w - - 0 1");
+	pos = init_position("1k5r/8/8/8/5pP1/2P5/3P4/1K6 b - g3 0 1");
 
-	Move move_en_passant = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_F4, .destination = SQ_G3
-	};
+	Move move_en_passant = make_move(
+		SQ_F4, SQ_G3, EN_PASSANT, NO_PIECE_TYPE
+	);
 	do_move(pos, move_en_passant);
 
 	TEST_ASSERT_EQUAL_UINT64(0x8200000000440802, pos->state->occupied);
@@ -648,8 +766,7 @@ void test_do_move(void)
 
 	TEST_ASSERT_EQUAL(W_PAWN, pos->state->captured_piece);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_do_castling(void)
@@ -674,46 +791,22 @@ void test_undo_move(void)
 		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 	);
 
-	Move move = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E2, .destination = SQ_E4
-	};
+	Move move = make_move(SQ_E2, SQ_E4, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move);
 
-	Move move_2 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E7, .destination = SQ_E5
-	};
+	Move move_2 = make_move(SQ_E7, SQ_E5, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_2);
 
-	Move move_3 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_G1, .destination = SQ_F3
-	};
+	Move move_3 = make_move(SQ_G1, SQ_F3, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_3);
 
-	Move move_4 = {
-		.move_type = COMMON, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_E7
-	};
+	Move move_4 = make_move(SQ_E8, SQ_E7, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_4);
 
-	Move move_5 = {
-		.move_type = COMMON, .moved_piece_type = KNIGHT,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_F3, .destination = SQ_E5
-	};
+	Move move_5 = make_move(SQ_F3, SQ_E5, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_5);
 
-	Move move_6 = {
-		.move_type = COMMON, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_D7, .destination = SQ_D6
-	};
+	Move move_6 = make_move(SQ_D7, SQ_D6, COMMON, NO_PIECE_TYPE);
 	do_move(pos, move_6);
 
 	undo_move(pos);
@@ -766,17 +859,14 @@ void test_undo_move(void)
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 	TEST_ASSERT_EQUAL_UINT32(0, pos->state->move_50_rule);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for castling
 	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R w KQkq - 0 1");
 
-	Move move_castling_white_00 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_G1
-	};
+	Move move_castling_white_00 = make_move(
+		SQ_E1, SQ_G1, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_white_00);
 	undo_move(pos);
 
@@ -800,16 +890,13 @@ void test_undo_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R w KQkq - 0 1");
 
-	Move move_castling_white_000 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = WHITE,
-		.source = SQ_E1, .destination = SQ_C1
-	};
+	Move move_castling_white_000 = make_move(
+		SQ_E1, SQ_C1, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_white_000);
 	undo_move(pos);
 
@@ -833,16 +920,13 @@ void test_undo_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R b KQkq - 0 1");
 
-	Move move_castling_black_00 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_G8
-	};
+	Move move_castling_black_00 = make_move(
+		SQ_E8, SQ_G8, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_black_00);
 	undo_move(pos);
 
@@ -866,16 +950,13 @@ void test_undo_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("r3k2r/ppp1pppp/8/8/8/8/PPP1PPPP/R3K2R b KQkq - 0 1");
 
-	Move move_castling_black_000 = {
-		.move_type = CASTLING, .moved_piece_type = KING,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_E8, .destination = SQ_C8
-	};
+	Move move_castling_black_000 = make_move(
+		SQ_E8, SQ_C8, CASTLING, NO_PIECE_TYPE
+	);
 	do_move(pos, move_castling_black_000);
 	undo_move(pos);
 
@@ -899,17 +980,12 @@ void test_undo_move(void)
 
 	TEST_ASSERT_EQUAL_UINT32(ALL_CASTLING, pos->state->castling);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for promotion
 	pos = init_position("8/7P/k7/8/8/8/K7/8 w - - 0 1");
 
-	Move move_promotion = {
-		.move_type = PROMOTION, .moved_piece_type = PAWN,
-		.promotion_piece_type = QUEEN, .color = WHITE,
-		.source = SQ_H7, .destination = SQ_H8
-	};
+	Move move_promotion = make_move(SQ_H7, SQ_H8, PROMOTION, QUEEN);
 	do_move(pos, move_promotion);
 	undo_move(pos);
 
@@ -931,23 +1007,20 @@ void test_undo_move(void)
 	TEST_ASSERT_EQUAL_UINT64(0x10000000000ULL, pos->board.BlackKing);
 	TEST_ASSERT_EQUAL_UINT64(0x80000000000000ULL, pos->board.WhitePawns);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	// Tests for en passant
-	pos = init_position("1k5r/8/8/8/5pP1/2P5/3P4/1K6 w - - 0 1");
+	pos = init_position("1k5r/8/8/8/5pP1/2P5/3P4/1K6 b - g3 0 1");
 
-	Move move_en_passant = {
-		.move_type = EN_PASSANT, .moved_piece_type = PAWN,
-		.promotion_piece_type = NO_PIECE_TYPE, .color = BLACK,
-		.source = SQ_F4, .destination = SQ_G3
-	};
+	Move move_en_passant = make_move(
+		SQ_F4, SQ_G3, EN_PASSANT, NO_PIECE_TYPE
+	);
 	do_move(pos, move_en_passant);
 	undo_move(pos);
 
 	TEST_ASSERT_EQUAL_UINT64(0x8200000060040802, pos->state->occupied);
-	TEST_ASSERT_EQUAL_UINT64(0x40040802, pos->state->allies);
-	TEST_ASSERT_EQUAL_UINT64(0x8200000020000000, pos->state->enemies);
+	TEST_ASSERT_EQUAL_UINT64(0x8200000020000000, pos->state->allies);
+	TEST_ASSERT_EQUAL_UINT64(0x40040802, pos->state->enemies);
 
 	TEST_ASSERT_EQUAL_UINT64(0x00ULL, pos->board.WhiteKnights);
 	TEST_ASSERT_EQUAL_UINT64(0x00ULL, pos->board.BlackKnights);
@@ -963,8 +1036,7 @@ void test_undo_move(void)
 	TEST_ASSERT_EQUAL_UINT64(0x20000000ULL, pos->board.BlackPawns);
 	TEST_ASSERT_EQUAL_UINT64(0x8000000000000000ULL, pos->board.BlackRooks);
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_get_check_type(void)
@@ -973,22 +1045,19 @@ void test_get_check_type(void)
 
 	TEST_ASSERT_EQUAL(DOUBLE_CHECK, get_check_type(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("8/1b6/8/8/4K3/8/pp6/k7 w - - 0 1");
 
 	TEST_ASSERT_EQUAL(SINGLE_CHECK, get_check_type(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position("8/8/8/8/2R1K3/8/pp6/k7 w - - 0 1");
 
 	TEST_ASSERT_EQUAL(NO_CHECK, get_check_type(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 }
 
 void test_get_pinned(void)
@@ -1035,27 +1104,17 @@ void test_get_pinned(void)
 	TEST_ASSERT_EQUAL_UINT64(0x00ULL, get_pinned(pos_5));
 	TEST_ASSERT_EQUAL_UINT64(0x00ULL, get_pinned(pos_10));
 
-	free(pos_1->state);
-	free(pos_2->state);
-	free(pos_3->state);
-	free(pos_4->state);
-	free(pos_5->state);
-	free(pos_6->state);
-	free(pos_7->state);
-	free(pos_8->state);
-	free(pos_9->state);
-	free(pos_10->state);
-
-	free(pos_1);
-	free(pos_2);
-	free(pos_3);
-	free(pos_4);
-	free(pos_5);
-	free(pos_6);
-	free(pos_7);
-	free(pos_8);
-	free(pos_9);
-	free(pos_10);
+
+	free_position(pos_1);
+	free_position(pos_2);
+	free_position(pos_3);
+	free_position(pos_4);
+	free_position(pos_5);
+	free_position(pos_6);
+	free_position(pos_7);
+	free_position(pos_8);
+	free_position(pos_9);
+	free_position(pos_10);
 
 	Position *pos = init_position(
 		"7k/b5b1/8/8/8/Q7/1P6/K1R3rq w - - 0 1"
@@ -1063,8 +1122,7 @@ void test_get_pinned(void)
 
 	TEST_ASSERT_EQUAL(0x204ULL, get_pinned(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
 
 	pos = init_position(
 		"4R3/8/4b3/4k3/5n2/2bN4/7Q/1K6 b - - 0 1"
@@ -1072,6 +1130,178 @@ void test_get_pinned(void)
 
 	TEST_ASSERT_EQUAL(0x100020000000ULL, get_pinned(pos));
 
-	free(pos->state);
-	free(pos);
+	free_position(pos);
+}
+
+void test_state_history(void)
+{
+	Position *pos = init_position(
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+	);
+
+	TEST_ASSERT_EQUAL(pos->state_history, pos->state);
+
+	Move move = make_move(SQ_E2, SQ_E4, COMMON, NO_PIECE_TYPE);
+
+	do_move(pos, move);
+
+	TEST_ASSERT_EQUAL(&pos->state_history[1], pos->state);
+
+	do_null_move(pos);
+
+	TEST_ASSERT_EQUAL(&pos->state_history[2], pos->state);
+	TEST_ASSERT_EQUAL_UINT64(
+		pos->state_history[1].occupied, pos->state->occupied
+	);
+
+	undo_null_move(pos);
+
+	TEST_ASSERT_EQUAL(&pos->state_history[1], pos->state);
+
+	undo_move(pos);
+
+	TEST_ASSERT_EQUAL(pos->state_history, pos->state);
+	TEST_ASSERT_EQUAL_UINT64(0xFFFF00000000FFFFULL, pos->state->occupied);
+
+	free_position(pos);
+}
+
+/**
+ * \brief Checks the incremental key against the full recomputation and that
+ * the move changed the key, #NodeCallback of test_incremental_key()
+ */
+static void check_key(Position *pos, void *data)
+{
+	(void)data;
+
+	TEST_ASSERT_EQUAL_UINT64(generate_hash_key(pos), pos->state->key);
+
+	if (pos->state != pos->state_history)
+		TEST_ASSERT_NOT_EQUAL((pos->state - 1)->key, pos->state->key);
+}
+
+void test_incremental_key(void)
+{
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	TEST_ASSERT_EQUAL_UINT64(generate_hash_key(pos), pos->state->key);
+
+	walk_tree(pos, 3, check_key, NULL);
+
+	// Promotions with captures and en passant
+	free_position(pos);
+	pos = init_position("n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1");
+
+	walk_tree(pos, 3, check_key, NULL);
+
+	free_position(pos);
+	pos = init_position("8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1");
+
+	TEST_ASSERT_EQUAL(SQ_D3, pos->state->en_passant);
+	TEST_ASSERT_EQUAL_UINT64(generate_hash_key(pos), pos->state->key);
+
+	walk_tree(pos, 3, check_key, NULL);
+
+	// Null move changes only the side and the en passant square
+	U64 key = pos->state->key;
+
+	do_null_move(pos);
+
+	TEST_ASSERT_EQUAL_UINT64(
+		key ^ side_key ^ en_passant_keys[file_of(SQ_D3)], pos->state->key
+	);
+
+	undo_null_move(pos);
+
+	TEST_ASSERT_EQUAL_UINT64(key, pos->state->key);
+
+	free_position(pos);
+}
+
+void test_is_repetition(void)
+{
+	Position *pos = init_position(
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+	);
+
+	Move shuffle[4] = {
+		make_move(SQ_G1, SQ_F3, COMMON, NO_PIECE_TYPE),
+		make_move(SQ_G8, SQ_F6, COMMON, NO_PIECE_TYPE),
+		make_move(SQ_F3, SQ_G1, COMMON, NO_PIECE_TYPE),
+		make_move(SQ_F6, SQ_G8, COMMON, NO_PIECE_TYPE),
+	};
+
+	for (int i = 0; i < 4; i++) {
+		TEST_ASSERT_FALSE(is_repetition(pos));
+
+		do_move(pos, shuffle[i]);
+	}
+
+	// Back to the start position
+	TEST_ASSERT_TRUE(is_repetition(pos));
+	TEST_ASSERT_TRUE(is_draw(pos));
+
+	// The same shuffle after pawn moves can't repeat anything before them
+	do_move(pos, make_move(SQ_E2, SQ_E3, COMMON, NO_PIECE_TYPE));
+	do_move(pos, make_move(SQ_E7, SQ_E6, COMMON, NO_PIECE_TYPE));
+
+	for (int i = 0; i < 4; i++) {
+		TEST_ASSERT_FALSE(is_repetition(pos));
+
+		do_move(pos, shuffle[i]);
+	}
+
+	TEST_ASSERT_TRUE(is_repetition(pos));
+
+	for (int i = 0; i < 6; i++)
+		undo_move(pos);
+
+	// A null move breaks the repetition
+	do_move(pos, shuffle[0]);
+	do_null_move(pos);
+	do_move(pos, shuffle[2]);
+	do_null_move(pos);
+
+	TEST_ASSERT_FALSE(is_repetition(pos));
+
+	free_position(pos);
+}
+
+void test_is_draw_50_rule(void)
+{
+	Position *pos = init_position("7k/8/8/8/8/8/8/KQ6 w - - 99 80");
+
+	TEST_ASSERT_EQUAL_UINT32(99, pos->state->move_50_rule);
+	TEST_ASSERT_FALSE(is_draw(pos));
+
+	// The history before the FEN is unknown, nothing repeats
+	TEST_ASSERT_FALSE(is_repetition(pos));
+
+	do_move(pos, make_move(SQ_B1, SQ_B2, COMMON, NO_PIECE_TYPE));
+
+	TEST_ASSERT_TRUE(is_draw(pos));
+
+	free_position(pos);
+}
+
+void test_is_draw_50_rule_checkmate(void)
+{
+	Position *pos = init_position("7k/8/6K1/8/8/8/8/Q7 w - - 99 80");
+
+	// Checkmate on the 100th ply is a win, not a draw
+	do_move(pos, make_move(SQ_A1, SQ_A8, COMMON, NO_PIECE_TYPE));
+
+	TEST_ASSERT_EQUAL_UINT32(100, pos->state->move_50_rule);
+	TEST_ASSERT_FALSE(is_draw(pos));
+
+	undo_move(pos);
+
+	// A check the king can escape is still a draw
+	do_move(pos, make_move(SQ_A1, SQ_H1, COMMON, NO_PIECE_TYPE));
+
+	TEST_ASSERT_TRUE(is_draw(pos));
+
+	free_position(pos);
 }
@@ -12,11 +12,15 @@
 #include "uci.h"
 
 #include <stdlib.h>
+#include <pthread.h>
 
 // Initializing everything needed for tests
 void test_init(void)
 {
 	init_rays();
+	init_patterns();
+	init_slider_attacks();
+	init_reductions();
 }
 
 void test_find_best(void)
@@ -25,13 +29,222 @@ void test_find_best(void)
 		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
 	);
 
-	ExtMove best = find_best(pos, 1);
+	SearchContext *context = init_search_context(1);
 
-	TEST_ASSERT_TRUE(best.move.moved_piece_type != NO_PIECE_TYPE);
-	TEST_ASSERT_TRUE(best.move.color < COLOR_NB);
-	TEST_ASSERT_TRUE(best.move.destination < SQ_NB);
-	TEST_ASSERT_TRUE(best.move.source < SQ_NB);
+	TEST_ASSERT_NOT_NULL(context);
 
-	free(pos->state);
-	free(pos);
+	ExtMove best = find_best(context, pos, 1);
+
+	Piece piece = piece_on(pos, source_of_move(best.move));
+
+	TEST_ASSERT_TRUE(best.move != MOVE_NONE);
+	TEST_ASSERT_TRUE(piece != NO_PIECE);
+	TEST_ASSERT_EQUAL(WHITE, color_of_piece(piece));
+
+	TEST_ASSERT_EQUAL(1, context->depth);
+	TEST_ASSERT_GREATER_THAN(0, context->nodes);
+
+	free_search_context(context);
+	free_position(pos);
+}
+
+void test_quiescence(void)
+{
+	const Evaluation queen = piece_type_value[MIDDLEGAME][QUEEN - 1];
+
+	SearchContext *context = init_search_context(1);
+	SearchThread *thread = &context->threads[0];
+
+	// The hanging queen is taken, the defended one is not
+	Position *pos = init_position("4k3/8/8/3q4/8/8/8/3QK3 w - - 0 1");
+
+	init_search_thread(thread, context, pos, 0);
+
+	TEST_ASSERT_GREATER_THAN(
+		queen / 2, quiescence(thread, BLACK_WIN, WHITE_WIN)
+	);
+
+	free_position(pos);
+
+	pos = init_position("3rk3/8/8/3q4/8/8/8/3QK3 w - - 0 1");
+
+	init_search_thread(thread, context, pos, 0);
+
+	TEST_ASSERT_LESS_THAN(
+		queen / 2, quiescence(thread, BLACK_WIN, WHITE_WIN)
+	);
+
+	free_position(pos);
+
+	// Mated in check, no stand pat
+	pos = init_position("R5k1/5ppp/8/8/8/8/8/6K1 b - - 0 1");
+
+	init_search_thread(thread, context, pos, 0);
+
+	TEST_ASSERT_EQUAL(BLACK_WIN, quiescence(thread, BLACK_WIN, WHITE_WIN));
+
+	free_position(pos);
+
+	TEST_ASSERT_EQUAL(0, thread->ply);
+
+	free_search_context(context);
+}
+
+void test_negamax_max_ply(void)
+{
+	SearchContext *context = init_search_context(1);
+	SearchThread *thread = &context->threads[0];
+
+	Position *pos = init_position(
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -"
+	);
+
+	init_search_thread(thread, context, pos, 0);
+
+	const Move root_move = make_move(SQ_E2, SQ_A6, COMMON, NO_PIECE_TYPE);
+
+	thread->pv_table[0][0] = root_move;
+	thread->pv_table[0][1] = root_move;
+	thread->pv_lenght[0] = 2;
+
+	// The children of the last ply stop without touching the PV table
+	thread->ply = MAX_PLY - 1;
+
+	negamax(thread, 2, BLACK_WIN, WHITE_WIN);
+
+	TEST_ASSERT_EQUAL(MAX_PLY - 1, thread->ply);
+	TEST_ASSERT_EQUAL(MAX_PLY, thread->pv_lenght[MAX_PLY - 1]);
+	TEST_ASSERT_TRUE(
+		thread->pv_table[MAX_PLY - 1][MAX_PLY - 1] != MOVE_NONE
+	);
+
+	TEST_ASSERT_EQUAL(2, thread->pv_lenght[0]);
+	TEST_ASSERT_EQUAL(root_move, thread->pv_table[0][0]);
+	TEST_ASSERT_EQUAL(root_move, thread->pv_table[0][1]);
+
+	free_position(pos);
+	free_search_context(context);
+}
+
+void test_find_best_threads(void)
+{
+	Position *pos = init_position("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+
+	U64 key = pos->state->key;
+
+	SearchContext *context = init_search_context(1);
+
+	TEST_ASSERT_TRUE(set_search_threads(context, 4));
+	TEST_ASSERT_EQUAL(4, context->threads_nb);
+
+	ExtMove best = find_best(context, pos, 4);
+
+	// Back rank mate, the position is left as it was
+	TEST_ASSERT_EQUAL(make_move(SQ_A1, SQ_A8, COMMON, 0), best.move);
+	TEST_ASSERT_GREATER_THAN(WHITE_WIN - MAX_PLY, best.eval);
+	TEST_ASSERT_EQUAL_UINT64(key, pos->state->key);
+
+	free_search_context(context);
+	free_position(pos);
+}
+
+/// Analysis of one position with its own search context
+typedef struct Analysis {
+	const char *fen;	///< Position to analyze
+	ExtMove best;		///< Result of the search
+} Analysis;
+
+static void *analyze(void *arg)
+{
+	Analysis *analysis = arg;
+
+	Position *pos = init_position(analysis->fen);
+	SearchContext *context = init_search_context(1);
+
+	analysis->best = find_best(context, pos, 4);
+
+	free_search_context(context);
+	free_position(pos);
+
+	return NULL;
+}
+
+void test_find_best_reentrant(void)
+{
+	Analysis analyses[2] = {
+		{.fen = "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"},
+		{.fen = "r5k1/8/8/8/8/8/5PPP/6K1 b - - 0 1"},
+	};
+
+	pthread_t threads[2];
+
+	// Two independent searches at the same time in one process
+	for (int i = 0; i < 2; i++)
+		pthread_create(&threads[i], NULL, analyze, &analyses[i]);
+
+	for (int i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+
+	TEST_ASSERT_EQUAL(
+		make_move(SQ_A1, SQ_A8, COMMON, 0), analyses[0].best.move
+	);
+	TEST_ASSERT_EQUAL(
+		make_move(SQ_A8, SQ_A1, COMMON, 0), analyses[1].best.move
+	);
+}
+
+void test_find_best_aspiration(void)
+{
+	Position *pos = init_position("4k3/8/8/3q4/8/8/8/3QK3 w - - 0 1");
+
+	SearchContext *context = init_search_context(1);
+
+	context->aspiration_delta = 0;
+
+	ExtMove full = find_best(context, pos, 5);
+
+	// The narrowest window fails at almost every iteration, the re-searches
+	// still find the same move
+	context->aspiration_delta = 1;
+
+	ExtMove narrow = find_best(context, pos, 5);
+
+	TEST_ASSERT_EQUAL(make_move(SQ_D1, SQ_D5, COMMON, 0), full.move);
+	TEST_ASSERT_EQUAL(full.move, narrow.move);
+	TEST_ASSERT_EQUAL(5, context->depth);
+
+	free_search_context(context);
+	free_position(pos);
+}
+
+void test_history_index(void)
+{
+	bool used[12] = {false};
+
+	for (Color color = WHITE; color <= BLACK; color++) {
+		for (PieceType pt = PAWN; pt <= KING; pt++) {
+			uint32_t index = history_index(make_piece(color, pt));
+
+			// Every piece has its own row
+			TEST_ASSERT_LESS_THAN(12, index);
+			TEST_ASSERT_FALSE(used[index]);
+
+			used[index] = true;
+		}
+	}
+}
+
+void test_find_best_draws(void)
+{
+	// Every move of the queen side reaches the 50 move rule
+	Position *pos = init_position("7k/8/8/8/8/8/8/KQ6 w - - 99 80");
+
+	SearchContext *context = init_search_context(1);
+
+	ExtMove best = find_best(context, pos, 3);
+
+	TEST_ASSERT_EQUAL(DRAW, best.eval);
+
+	free_search_context(context);
+	free_position(pos);
 }
@@ -0,0 +1,140 @@
+#include "unity.h"
+#include "bitboard.h"
+#include "bitboard_mapping.h"
+#include "evaluate.h"
+#include "position.h"
+#include "piece.h"
+#include "rays.h"
+#include "patterns.h"
+#include "masks.h"
+#include "transposition.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Initializing everything needed for tests
+void test_init(void)
+{
+	init_rays();
+	init_patterns();
+	init_slider_attacks();
+}
+
+void test_tt_resize(void)
+{
+	TEST_ASSERT_TRUE(tt_resize(1));
+
+	TEST_ASSERT_EQUAL_UINT64((1 << 20) / sizeof(TTBucket), tt.bucket_count);
+	TEST_ASSERT_EQUAL(0, (uintptr_t)tt.buckets & 63);
+	TEST_ASSERT_EQUAL(64, sizeof(TTBucket));
+
+	TEST_ASSERT_TRUE(tt_resize(3));
+
+	TEST_ASSERT_EQUAL_UINT64((2 << 20) / sizeof(TTBucket), tt.bucket_count);
+
+	tt_free();
+
+	TTData entry;
+
+	TEST_ASSERT_NULL(tt.buckets);
+	TEST_ASSERT_EQUAL_UINT64(0, tt.bucket_count);
+	TEST_ASSERT_FALSE(tt_probe(0x1234ULL, &entry));
+}
+
+void test_tt_store_and_probe(void)
+{
+	Move move = make_move(SQ_E1, SQ_G1, CASTLING, NO_PIECE_TYPE);
+
+	TTData entry;
+
+	tt_resize(1);
+
+	TEST_ASSERT_FALSE(tt_probe(0xDEADBEEFULL, &entry));
+
+	tt_store(0xDEADBEEFULL, 5, BOUND_LOWER, 42, move, 0);
+
+	TEST_ASSERT_TRUE(tt_probe(0xDEADBEEFULL, &entry));
+	TEST_ASSERT_EQUAL(5, entry.depth);
+	TEST_ASSERT_EQUAL(42, entry.score);
+	TEST_ASSERT_EQUAL(BOUND_LOWER, tt_bound(&entry));
+
+	TEST_ASSERT_EQUAL(move, entry.move);
+
+	// Same key without a move keeps the old move, negative and mate
+	// scores survive the packing
+	tt_store(0xDEADBEEFULL, 6, BOUND_EXACT, BLACK_WIN + 3, MOVE_NONE, 0);
+
+	TEST_ASSERT_TRUE(tt_probe(0xDEADBEEFULL, &entry));
+	TEST_ASSERT_EQUAL(6, entry.depth);
+	TEST_ASSERT_EQUAL(BLACK_WIN + 3, entry.score);
+	TEST_ASSERT_EQUAL(BOUND_EXACT, tt_bound(&entry));
+	TEST_ASSERT_EQUAL(move, entry.move);
+
+	// An entry torn by two writers fails the key check
+	TTEntry *slot = &tt.buckets[0xDEADBEEFULL & (tt.bucket_count - 1)]
+		.entries[0];
+
+	atomic_store(&slot->data, atomic_load(&slot->data) ^ 1);
+
+	TEST_ASSERT_FALSE(tt_probe(0xDEADBEEFULL, &entry));
+
+	tt_store(0xDEADBEEFULL, 6, BOUND_EXACT, -10, MOVE_NONE, 0);
+
+	TEST_ASSERT_TRUE(tt_probe(0xDEADBEEFULL, &entry));
+
+	tt_clear();
+
+	TEST_ASSERT_FALSE(tt_probe(0xDEADBEEFULL, &entry));
+
+	tt_free();
+}
+
+void test_tt_replacement(void)
+{
+	TTData entry;
+
+	tt_resize(1);
+
+	// All keys fall into the same bucket
+	U64 step = tt.bucket_count;
+
+	for (uint32_t i = 0; i < TT_BUCKET_SIZE; i++)
+		tt_store(i * step, 10 + i, BOUND_EXACT, 0, MOVE_NONE, 0);
+
+	tt_store(TT_BUCKET_SIZE * step, 1, BOUND_EXACT, 0, MOVE_NONE, 0);
+
+	// The shallowest entry was replaced
+	TEST_ASSERT_FALSE(tt_probe(0, &entry));
+	TEST_ASSERT_TRUE(tt_probe(TT_BUCKET_SIZE * step, &entry));
+
+	for (uint32_t i = 1; i < TT_BUCKET_SIZE; i++)
+		TEST_ASSERT_TRUE(tt_probe(i * step, &entry));
+
+	// Entries of old searches are replaced before deep ones
+	tt_new_search();
+	tt_end_search();
+
+	uint8_t generation = tt_new_search();
+
+	TEST_ASSERT_EQUAL(2, generation);
+
+	tt_store(
+		TT_BUCKET_SIZE * step, 1, BOUND_EXACT, 0, MOVE_NONE, generation
+	);
+	tt_store(
+		(TT_BUCKET_SIZE + 1) * step, 2, BOUND_EXACT, 0, MOVE_NONE,
+		generation
+	);
+
+	TEST_ASSERT_TRUE(tt_probe(TT_BUCKET_SIZE * step, &entry));
+	TEST_ASSERT_TRUE(tt_probe((TT_BUCKET_SIZE + 1) * step, &entry));
+	TEST_ASSERT_FALSE(tt_probe(1 * step, &entry));
+
+	// The table stays as it is while a search is running
+	TEST_ASSERT_FALSE(tt_resize(1));
+
+	tt_end_search();
+
+	tt_free();
+}